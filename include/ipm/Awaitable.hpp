@@ -0,0 +1,147 @@
+/**
+ * @file Awaitable.hpp Coroutine awaitables for Receivers and Senders
+ *
+ * When built as C++20, async_receive() and async_send() give awaitables
+ * for use in coroutines:
+ *   auto result = co_await async_receive(receiver, timeout);
+ *   auto status = co_await async_send(sender, message, size, timeout);
+ * which are the Result of Receiver::try_receive_buffer() and the Status of
+ * Sender::try_send(), with Status::Timeout if the timeout expired. Rather
+ * than blocking, a coroutine which can't go ahead straight away is
+ * suspended on the calling thread's Reactor, and resumed from it once the
+ * Receiver is readable or the Sender writable; the Reactor therefore has
+ * to be run on that thread. Waiting requires a valid poll_handle(), and a
+ * message being sent must stay valid until the co_await completes.
+ *
+ * This header is separate from Receiver.hpp and Sender.hpp so that only
+ * code using the awaitables pulls in the Reactor, and with it epoll and
+ * ZMQ. IPM_HAVE_COROUTINES is defined when they are available
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_AWAITABLE_HPP_
+#define IPM_INCLUDE_IPM_AWAITABLE_HPP_
+
+#include "ipm/Reactor.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/Status.hpp"
+
+#include <string>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define IPM_HAVE_COROUTINES 1
+#endif
+
+#ifdef IPM_HAVE_COROUTINES
+namespace dunedaq::ipm {
+
+class ReceiveAwaitable
+{
+public:
+  ReceiveAwaitable(Receiver& receiver, const Receiver::duration_type& timeout)
+    : receiver_(receiver)
+    , deadline_(Reactor::deadline_for(timeout))
+  {}
+
+  bool await_ready() { return attempt(); }
+
+  void await_suspend(std::coroutine_handle<> handle)
+  {
+    Reactor::instance().wait(
+      receiver_.poll_handle(), Reactor::Interest::Readable, deadline_, [this, handle](bool expired) {
+        if (!expired && !attempt()) {
+          return false;
+        }
+        handle.resume();
+        return true;
+      });
+  }
+
+  Result<Receiver::BufferResponse> await_resume() { return std::move(result_); }
+
+private:
+  // Returns true once there's an outcome other than a timeout
+  bool attempt()
+  {
+    result_ = receiver_.try_receive_buffer(Receiver::noblock);
+    return result_.status != Status::Timeout;
+  }
+
+  Receiver& receiver_;
+  Reactor::clock_type::time_point deadline_;
+  Result<Receiver::BufferResponse> result_;
+};
+
+class SendAwaitable
+{
+public:
+  SendAwaitable(Sender& sender,
+                const void* message,
+                Sender::size_type message_size,
+                const Sender::duration_type& timeout,
+                std::string const& metadata)
+    : sender_(sender)
+    , message_(message)
+    , message_size_(message_size)
+    , deadline_(Reactor::deadline_for(timeout))
+    , metadata_(metadata)
+  {}
+
+  bool await_ready() { return attempt(); }
+
+  void await_suspend(std::coroutine_handle<> handle)
+  {
+    Reactor::instance().wait(
+      sender_.poll_handle(), Reactor::Interest::Writable, deadline_, [this, handle](bool expired) {
+        if (!expired && !attempt()) {
+          return false;
+        }
+        handle.resume();
+        return true;
+      });
+  }
+
+  Status await_resume() const noexcept { return status_; }
+
+private:
+  // Returns true once there's an outcome other than a timeout
+  bool attempt()
+  {
+    status_ = sender_.try_send(message_, message_size_, Sender::noblock, metadata_);
+    return status_ != Status::Timeout;
+  }
+
+  Sender& sender_;
+  const void* message_;
+  Sender::size_type message_size_;
+  Reactor::clock_type::time_point deadline_;
+  std::string metadata_;
+  Status status_{ Status::Timeout };
+};
+
+inline ReceiveAwaitable
+async_receive(Receiver& receiver, const Receiver::duration_type& timeout)
+{
+  return ReceiveAwaitable(receiver, timeout);
+}
+
+inline SendAwaitable
+async_send(Sender& sender,
+           const void* message,
+           Sender::size_type message_size,
+           const Sender::duration_type& timeout,
+           std::string const& metadata = "")
+{
+  return SendAwaitable(sender, message, message_size, timeout, metadata);
+}
+
+} // namespace dunedaq::ipm
+#endif // IPM_HAVE_COROUTINES
+
+#endif // IPM_INCLUDE_IPM_AWAITABLE_HPP_
@@ -0,0 +1,424 @@
+/**
+ * @file BufferPool.hpp BufferPool Class Interface
+ *
+ * BufferPool hands out blocks of memory for received messages from size
+ * classes of 64 bytes up to 1 MiB, in powers of two, and takes them back
+ * when the MessageBuffer holding them is destroyed, so that a steady
+ * stream of messages reuses the same blocks instead of going through
+ * malloc and free for each one.
+ *
+ * Each thread keeps a cache of free blocks per size class, so allocating
+ * and releasing take no locks. Messages are usually released by a
+ * different thread from the one which received them, so a cache which
+ * grows past its limit passes half of its blocks to a shared depot for
+ * the size class, from which an empty cache takes a batch; the depot's
+ * mutex is therefore only taken once per batch. Blocks larger than the
+ * largest size class come straight from the heap.
+ *
+ * A block stays with the NUMA node of the thread which first allocated,
+ * and so first touched, it. Each node has depots of its own, and a thread
+ * only takes blocks from its own node's depots; blocks released by a
+ * thread on another node are set aside and passed back to their node's
+ * depots in batches. A thread's node is the one it was running on when it
+ * first used the pool, so threads should be pinned before then.
+ *
+ * statistics() counts over all threads, and may be called from any of
+ * them
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
+#define IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
+
+#include "ipm/MessageBuffer.hpp"
+#include "ipm/ThreadPlacement.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+class BufferPool
+{
+  struct Header;
+
+public:
+  static constexpr size_t min_block_size = 64;
+  static constexpr size_t size_classes = 15; // Up to 64 << 14, i.e. 1 MiB
+  static constexpr size_t max_block_size = min_block_size << (size_classes - 1);
+
+  // Each thread caches up to this many bytes of each size class, but at least 2 blocks
+  // and at most 256, and the depot for each size class holds up to 16 times as much
+  static constexpr size_t thread_cache_bytes = 1 << 20;
+
+  // Each NUMA node up to this many has depots of its own; higher ones share them
+  static constexpr size_t max_nodes = 64;
+
+  // A block of at least the size asked for, which goes back to the pool when it is
+  // destroyed, unless it has been handed over to a MessageBuffer first
+  class Block
+  {
+  public:
+    Block() = default;
+    ~Block() { reset(); }
+
+    Block(Block&& other) noexcept
+      : header_(std::exchange(other.header_, nullptr))
+    {}
+    Block& operator=(Block&& other) noexcept
+    {
+      if (this != &other) {
+        reset();
+        header_ = std::exchange(other.header_, nullptr);
+      }
+      return *this;
+    }
+
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+
+    char* data() const noexcept { return header_ ? reinterpret_cast<char*>(header_ + 1) : nullptr; } // NOLINT
+    size_t capacity() const noexcept { return header_ ? header_->capacity : 0; }
+    // The depots the block goes back to, those of its first allocating thread's node
+    size_t node() const noexcept { return header_ ? header_->node : 0; }
+    explicit operator bool() const noexcept { return header_ != nullptr; }
+
+    // The first "size" bytes of the block, as a MessageBuffer which returns the block to
+    // the pool when it is destroyed. The Block is left empty
+    MessageBuffer to_message_buffer(MessageBuffer::size_type size) &&
+    {
+      auto data = this->data();
+      return MessageBuffer(data, size, std::exchange(header_, nullptr), &BufferPool::release_owner);
+    }
+
+    void reset() noexcept
+    {
+      if (header_) {
+        BufferPool::instance().release(std::exchange(header_, nullptr));
+      }
+    }
+
+  private:
+    friend class BufferPool;
+    explicit Block(Header* header) noexcept
+      : header_(header)
+    {}
+
+    Header* header_{ nullptr };
+  };
+
+  struct Statistics
+  {
+    uint64_t allocations{ 0 };
+    uint64_t thread_cache_hits{ 0 };  // Allocations served by the thread's own cache
+    uint64_t depot_refills{ 0 };      // Batches taken from a depot by an empty cache
+    uint64_t system_allocations{ 0 }; // New blocks, when neither had one
+    uint64_t oversize_allocations{ 0 };
+    uint64_t blocks_in_use{ 0 };
+    uint64_t depot_blocks{ 0 };
+  };
+
+  static BufferPool& instance()
+  {
+    static BufferPool pool;
+    return pool;
+  }
+
+  Block allocate(size_t size);
+
+  // A MessageBuffer holding a pooled copy of the bytes; empty if there are none
+  MessageBuffer copy(const void* data, size_t size)
+  {
+    if (size == 0) {
+      return MessageBuffer();
+    }
+    auto block = allocate(size);
+    std::memcpy(block.data(), data, size);
+    return std::move(block).to_message_buffer(static_cast<MessageBuffer::size_type>(size));
+  }
+
+  Statistics statistics() const;
+
+  ~BufferPool()
+  {
+    for (auto& node_depots : depots_) {
+      for (auto& depot : node_depots) {
+        for (auto header : depot.blocks) {
+          ::operator delete(header);
+        }
+      }
+    }
+  }
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+  BufferPool(BufferPool&&) = delete;
+  BufferPool& operator=(BufferPool&&) = delete;
+
+private:
+  // Sits in front of each block's data, keeping it aligned for any fundamental type
+  struct alignas(16) Header
+  {
+    uint16_t size_class; // size_classes for an oversize block
+    uint16_t node;
+    uint64_t capacity;
+  };
+
+  // Only the owning thread changes its counters, so they are bumped with a plain load
+  // and store rather than a locked increment; they are atomic so statistics() can read them
+  struct ThreadCache
+  {
+    ThreadCache()
+      : node(node_index(placement::current_node()))
+    {
+      BufferPool::instance().attach(this);
+    }
+    ~ThreadCache() { BufferPool::instance().detach(this); }
+
+    const uint16_t node;
+    std::array<std::vector<Header*>, size_classes> free;
+    std::array<std::vector<Header*>, size_classes> remote; // Released here, from other nodes
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> releases{ 0 };
+  };
+
+  struct Depot
+  {
+    std::mutex mutex;
+    std::vector<Header*> blocks;
+  };
+
+  BufferPool() = default;
+
+  static ThreadCache& thread_cache()
+  {
+    thread_local ThreadCache cache;
+    return cache;
+  }
+
+  static void bump(std::atomic<uint64_t>& counter)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static uint16_t node_index(int node) { return static_cast<uint16_t>(node < 0 ? 0 : node % max_nodes); }
+
+  static size_t class_for(size_t size)
+  {
+    if (size <= min_block_size) {
+      return 0;
+    }
+    if (size > max_block_size) {
+      return size_classes;
+    }
+    // The number of bits in size - 1 is the power of two which holds it
+    return static_cast<size_t>(64 - __builtin_clzll(size - 1)) - 6;
+  }
+
+  static size_t cache_limit(size_t size_class)
+  {
+    return std::clamp<size_t>(thread_cache_bytes / (min_block_size << size_class), 2, 256);
+  }
+
+  static Header* new_block(size_t size_class, uint64_t capacity, uint16_t node)
+  {
+    auto header = static_cast<Header*>(::operator new(sizeof(Header) + capacity));
+    header->size_class = static_cast<uint16_t>(size_class);
+    header->node = node;
+    header->capacity = capacity;
+    return header;
+  }
+
+  // Makes sure a push_back within the cache's limit won't allocate
+  static void reserve(std::vector<Header*>& blocks, size_t size_class)
+  {
+    if (blocks.capacity() <= cache_limit(size_class)) {
+      blocks.reserve(cache_limit(size_class) + 1);
+    }
+  }
+
+  static void release_owner(void* owner) { instance().release(static_cast<Header*>(owner)); }
+
+  void release(Header* header);
+  void give_to_depot(size_t node, size_t size_class, std::vector<Header*>& blocks, size_t count);
+  void give_back_remote(size_t size_class, std::vector<Header*>& blocks);
+  void attach(ThreadCache* cache);
+  void detach(ThreadCache* cache);
+
+  mutable std::array<std::array<Depot, size_classes>, max_nodes> depots_;
+
+  mutable std::mutex caches_mutex_;
+  std::vector<ThreadCache*> caches_;
+  // The counts of threads which have exited
+  uint64_t retired_allocations_{ 0 };
+  uint64_t retired_hits_{ 0 };
+  uint64_t retired_releases_{ 0 };
+
+  std::atomic<uint64_t> depot_refills_{ 0 };
+  std::atomic<uint64_t> system_allocations_{ 0 };
+  std::atomic<uint64_t> oversize_allocations_{ 0 };
+};
+
+inline BufferPool::Block
+BufferPool::allocate(size_t size)
+{
+  auto& cache = thread_cache();
+  bump(cache.allocations);
+
+  auto size_class = class_for(size);
+  if (size_class == size_classes) {
+    oversize_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return Block(new_block(size_classes, size, cache.node));
+  }
+
+  auto& free = cache.free[size_class];
+  if (free.empty()) {
+    // Half the cache's limit is taken, so that it has room for as many to be released
+    auto& depot = depots_[cache.node][size_class];
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    auto count = std::min(depot.blocks.size(), cache_limit(size_class) / 2);
+    if (count > 0) {
+      free.insert(free.end(), depot.blocks.end() - count, depot.blocks.end());
+      depot.blocks.resize(depot.blocks.size() - count);
+      depot_refills_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (free.empty()) {
+    system_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return Block(new_block(size_class, min_block_size << size_class, cache.node));
+  }
+
+  bump(cache.hits);
+  auto header = free.back();
+  free.pop_back();
+  return Block(header);
+}
+
+inline void
+BufferPool::release(Header* header)
+{
+  auto& cache = thread_cache();
+  bump(cache.releases);
+
+  if (header->size_class == size_classes) {
+    ::operator delete(header);
+    return;
+  }
+
+  size_t size_class = header->size_class;
+  if (header->node != cache.node) {
+    auto& remote = cache.remote[size_class];
+    reserve(remote, size_class);
+    remote.push_back(header);
+    if (remote.size() > cache_limit(size_class)) {
+      give_back_remote(size_class, remote);
+    }
+    return;
+  }
+
+  auto& free = cache.free[size_class];
+  reserve(free, size_class);
+  free.push_back(header);
+  if (free.size() > cache_limit(size_class)) {
+    give_to_depot(cache.node, size_class, free, free.size() / 2);
+  }
+}
+
+// Moves the last "count" blocks to the node's depot, freeing those it has no room for
+inline void
+BufferPool::give_to_depot(size_t node, size_t size_class, std::vector<Header*>& blocks, size_t count)
+{
+  auto& depot = depots_[node][size_class];
+  auto first = blocks.end() - count;
+  {
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    auto room = 16 * cache_limit(size_class) - std::min(depot.blocks.size(), 16 * cache_limit(size_class));
+    auto kept = std::min(count, room);
+    depot.blocks.insert(depot.blocks.end(), first, first + kept);
+    first += kept;
+  }
+  for (auto it = first; it != blocks.end(); ++it) {
+    ::operator delete(*it);
+  }
+  blocks.resize(blocks.size() - count);
+}
+
+// Passes all the blocks to their own nodes' depots, a node at a time
+inline void
+BufferPool::give_back_remote(size_t size_class, std::vector<Header*>& blocks)
+{
+  std::sort(blocks.begin(), blocks.end(), [](Header* a, Header* b) { return a->node > b->node; });
+  while (!blocks.empty()) {
+    auto node = blocks.back()->node;
+    auto first = std::find_if(blocks.begin(), blocks.end(), [&](Header* header) { return header->node == node; });
+    give_to_depot(node, size_class, blocks, static_cast<size_t>(blocks.end() - first));
+  }
+}
+
+inline void
+BufferPool::attach(ThreadCache* cache)
+{
+  std::lock_guard<std::mutex> lock(caches_mutex_);
+  caches_.push_back(cache);
+}
+
+// A thread's cached blocks go to the depots when it exits, and its counts are kept
+inline void
+BufferPool::detach(ThreadCache* cache)
+{
+  for (size_t size_class = 0; size_class < size_classes; ++size_class) {
+    give_to_depot(cache->node, size_class, cache->free[size_class], cache->free[size_class].size());
+    give_back_remote(size_class, cache->remote[size_class]);
+  }
+
+  std::lock_guard<std::mutex> lock(caches_mutex_);
+  caches_.erase(std::remove(caches_.begin(), caches_.end(), cache), caches_.end());
+  retired_allocations_ += cache->allocations.load(std::memory_order_relaxed);
+  retired_hits_ += cache->hits.load(std::memory_order_relaxed);
+  retired_releases_ += cache->releases.load(std::memory_order_relaxed);
+}
+
+inline BufferPool::Statistics
+BufferPool::statistics() const
+{
+  Statistics statistics;
+  uint64_t releases = 0;
+  {
+    std::lock_guard<std::mutex> lock(caches_mutex_);
+    statistics.allocations = retired_allocations_;
+    statistics.thread_cache_hits = retired_hits_;
+    releases = retired_releases_;
+    for (auto cache : caches_) {
+      statistics.allocations += cache->allocations.load(std::memory_order_relaxed);
+      statistics.thread_cache_hits += cache->hits.load(std::memory_order_relaxed);
+      releases += cache->releases.load(std::memory_order_relaxed);
+    }
+  }
+  // Releases can be counted before the allocations they match, by a thread read first
+  statistics.blocks_in_use = statistics.allocations - std::min(releases, statistics.allocations);
+  statistics.depot_refills = depot_refills_.load(std::memory_order_relaxed);
+  statistics.system_allocations = system_allocations_.load(std::memory_order_relaxed);
+  statistics.oversize_allocations = oversize_allocations_.load(std::memory_order_relaxed);
+  for (auto& node_depots : depots_) {
+    for (auto& depot : node_depots) {
+      std::lock_guard<std::mutex> lock(depot.mutex);
+      statistics.depot_blocks += depot.blocks.size();
+    }
+  }
+  return statistics;
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_BUFFERPOOL_HPP_
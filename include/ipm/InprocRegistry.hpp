@@ -0,0 +1,168 @@
+/**
+ *
+ * @file InprocRegistry.hpp InprocRegistry Singleton class for pairing in-process Senders and Receivers
+ *
+ * InprocSender and InprocReceiver pass messages to each other within a
+ * process without going through ZMQ. Both sides look up the InprocChannel
+ * for their connection string in the process-wide InprocRegistry, which
+ * creates it for whichever side comes first. A channel is an MPSCQueue of
+ * MessageBuffers, so any number of Senders can hand over ownership of
+ * their buffers to the one Receiver without the payload being copied.
+ * Every side using a channel has to ask for the same queue capacity
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_INPROCREGISTRY_HPP_
+#define IPM_INCLUDE_IPM_INPROCREGISTRY_HPP_
+
+#include "ipm/MPSCQueue.hpp"
+#include "ipm/MessageBuffer.hpp"
+#include "ipm/Status.hpp"
+#include "ipm/Wakeup.hpp"
+
+#include "ers/Issue.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm,
+                  InprocReceiverAlreadyConnected,
+                  "Another Receiver is already connected to " << connection_string,
+                  ((std::string)connection_string))
+ERS_DECLARE_ISSUE(ipm,
+                  InprocCapacityMismatch,
+                  "A queue_capacity of " << capacity << " was given for " << connection_string
+                                         << ", which is already in use with a queue_capacity of " << existing,
+                  ((std::string)connection_string)((size_t)capacity)((size_t)existing))
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class InprocChannel
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  struct Message
+  {
+    MessageBuffer data;
+    std::string metadata;
+  };
+
+  explicit InprocChannel(size_t capacity)
+    : queue_(capacity)
+    , capacity_(capacity)
+  {}
+
+  // As asked for when the channel was created
+  size_t capacity() const noexcept { return capacity_; }
+
+  // A timeout too long to add to the current time never expires
+  static clock_type::time_point deadline_for(std::chrono::milliseconds timeout)
+  {
+    auto now = clock_type::now();
+    if (timeout == std::chrono::milliseconds::max() ||
+        timeout >= std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::time_point::max() - now)) {
+      return clock_type::time_point::max();
+    }
+    return now + timeout;
+  }
+
+  // Only one Receiver may take messages from a channel; returns false if one already has
+  bool claim_receiver() noexcept { return !has_receiver_.exchange(true); }
+  void release_receiver() noexcept { has_receiver_.store(false); }
+
+  // From any Sender: sleeps until the Receiver makes room in the queue or the deadline
+  // passes, leaving "message" untouched if it couldn't be queued
+  Status push(Message&& message, clock_type::time_point deadline)
+  {
+    while (!queue_.try_push(std::move(message))) {
+      if (!sender_wakeup_.wait_until(deadline, [this] { return !queue_.full(); })) {
+        return Status::Timeout;
+      }
+    }
+    receiver_wakeup_.notify();
+    return Status::Ok;
+  }
+
+  // From the Receiver: waits until the deadline for a message
+  Status pop(Message& message, clock_type::time_point deadline)
+  {
+    while (!queue_.try_pop(message)) {
+      if (!receiver_wakeup_.wait_until(deadline, [this] { return !queue_.empty(); })) {
+        return Status::Timeout;
+      }
+    }
+    sender_wakeup_.notify();
+    return Status::Ok;
+  }
+
+  InprocChannel(const InprocChannel&) = delete;
+  InprocChannel& operator=(const InprocChannel&) = delete;
+
+  InprocChannel(InprocChannel&&) = delete;
+  InprocChannel& operator=(InprocChannel&&) = delete;
+
+private:
+  MPSCQueue<Message> queue_;
+  size_t capacity_;
+  std::atomic<bool> has_receiver_{ false };
+  Wakeup receiver_wakeup_; // For the Receiver, once it finds the queue empty
+  Wakeup sender_wakeup_;   // For Senders, once they find the queue full
+};
+
+class InprocRegistry
+{
+public:
+  static InprocRegistry& instance()
+  {
+    static InprocRegistry registry;
+    return registry;
+  }
+
+  // Returns the channel for the connection string, creating it with room for "capacity"
+  // messages if no Sender or Receiver is using it. Messages still queued when the last
+  // of them goes away are dropped with the channel
+  // -Throws InprocCapacityMismatch if the channel exists with a different capacity
+  std::shared_ptr<InprocChannel> channel(std::string const& connection_string, size_t capacity)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = channels_[connection_string];
+    auto channel = entry.lock();
+    if (!channel) {
+      channel = std::make_shared<InprocChannel>(capacity);
+      entry = channel;
+    } else if (channel->capacity() != capacity) {
+      throw InprocCapacityMismatch(ERS_HERE, connection_string, capacity, channel->capacity());
+    }
+
+    for (auto it = channels_.begin(); it != channels_.end();) {
+      it = it->second.expired() ? channels_.erase(it) : std::next(it);
+    }
+    return channel;
+  }
+
+private:
+  InprocRegistry() {}
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::weak_ptr<InprocChannel>> channels_;
+
+  InprocRegistry(InprocRegistry const&) = delete;
+  InprocRegistry(InprocRegistry&&) = delete;
+  InprocRegistry& operator=(InprocRegistry const&) = delete;
+  InprocRegistry& operator=(InprocRegistry&&) = delete;
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_INPROCREGISTRY_HPP_
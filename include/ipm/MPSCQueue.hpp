@@ -0,0 +1,130 @@
+/**
+ * @file MPSCQueue.hpp MPSCQueue Class Interface
+ *
+ * MPSCQueue is a bounded, lock-free queue which any number of producer
+ * threads can push to and exactly one consumer thread pops from. It is
+ * Dmitry Vyukov's bounded queue: each slot carries a sequence number
+ * which tells a producer whether the slot is free and the consumer
+ * whether it has been filled, so producers only contend on one counter
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_MPSCQUEUE_HPP_
+#define IPM_INCLUDE_IPM_MPSCQUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace dunedaq::ipm {
+
+template<typename T>
+class MPSCQueue
+{
+
+public:
+  static constexpr size_t cache_line_size = 64;
+
+  explicit MPSCQueue(size_t capacity)
+    : capacity_(round_up_to_power_of_two(capacity))
+    , mask_(capacity_ - 1)
+    , cells_(new Cell[capacity_])
+  {
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  size_t capacity() const noexcept { return capacity_; }
+
+  // Producer side, from any thread: returns false, leaving "item" untouched, if the queue is full
+  bool try_push(T&& item)
+  {
+    Cell* cell = nullptr;
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side, from any thread: true if a push would fail for want of room
+  bool full() const noexcept
+  {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    auto seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+    return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0;
+  }
+
+  // Consumer side: returns false if the queue is empty
+  bool try_pop(T& item)
+  {
+    auto& cell = cells_[dequeue_pos_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+      return false;
+    }
+    item = std::move(cell.data);
+    cell.sequence.store(dequeue_pos_ + capacity_, std::memory_order_release);
+    ++dequeue_pos_;
+    return true;
+  }
+
+  // Consumer side only
+  bool empty() const noexcept
+  {
+    return cells_[dequeue_pos_ & mask_].sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1;
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  MPSCQueue(MPSCQueue&&) = delete;
+  MPSCQueue& operator=(MPSCQueue&&) = delete;
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence{ 0 };
+    T data{};
+  };
+
+  // A single cell's sequence can't tell a full queue from an empty one, so there are
+  // always at least two
+  static size_t round_up_to_power_of_two(size_t n)
+  {
+    size_t result = 2;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  alignas(cache_line_size) std::atomic<size_t> enqueue_pos_{ 0 };
+  alignas(cache_line_size) size_t dequeue_pos_{ 0 };
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_MPSCQUEUE_HPP_
@@ -0,0 +1,128 @@
+/**
+ * @file MessageBuffer.hpp MessageBuffer Class Interface
+ *
+ * MessageBuffer is a move-only handle to a contiguous block of message
+ * bytes whose storage is owned by some other object (e.g. a transport's
+ * native message type). The owner is released when the handle is
+ * destroyed, so payloads can be handed to users without being copied
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_MESSAGEBUFFER_HPP_
+#define IPM_INCLUDE_IPM_MESSAGEBUFFER_HPP_
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+class MessageBuffer
+{
+
+public:
+  using size_type = int;
+  using release_fn = void (*)(void* owner);
+
+  MessageBuffer() = default;
+
+  // Wrap "size" bytes at "data"; "release(owner)" is called exactly once, when the handle is destroyed or reset
+  MessageBuffer(const void* data, size_type size, void* owner, release_fn release) noexcept
+    : data_(static_cast<const char*>(data))
+    , size_(size)
+    , owner_(owner)
+    , release_(release)
+  {}
+
+  // Take ownership of a contiguous container (std::vector, std::string, ...). The
+  // bytes are located after the container has been moved, so small-buffer
+  // optimized types are safe to adopt
+  template<typename Container>
+  static MessageBuffer adopt(Container&& container)
+  {
+    using owner_type = std::decay_t<Container>;
+    static_assert(!std::is_lvalue_reference_v<Container>, "MessageBuffer::adopt requires an rvalue");
+    auto owner = new owner_type(std::move(container));
+    return MessageBuffer(std::data(*owner),
+                         static_cast<size_type>(std::size(*owner) * sizeof(*std::data(*owner))),
+                         owner,
+                         [](void* ptr) { delete static_cast<owner_type*>(ptr); }); // NOLINT
+  }
+
+  // Take ownership of an object (e.g. a std::unique_ptr or std::shared_ptr) which
+  // keeps "size" bytes at "data" alive
+  template<typename Owner>
+  static MessageBuffer adopt(Owner&& owner, const void* data, size_type size)
+  {
+    using owner_type = std::decay_t<Owner>;
+    static_assert(!std::is_lvalue_reference_v<Owner>, "MessageBuffer::adopt requires an rvalue");
+    return MessageBuffer(data, size, new owner_type(std::move(owner)), [](void* ptr) {
+      delete static_cast<owner_type*>(ptr); // NOLINT
+    });
+  }
+
+  ~MessageBuffer() { reset(); }
+
+  MessageBuffer(MessageBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , owner_(std::exchange(other.owner_, nullptr))
+    , release_(std::exchange(other.release_, nullptr))
+  {}
+
+  MessageBuffer& operator=(MessageBuffer&& other) noexcept
+  {
+    if (this != &other) {
+      reset();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      owner_ = std::exchange(other.owner_, nullptr);
+      release_ = std::exchange(other.release_, nullptr);
+    }
+    return *this;
+  }
+
+  MessageBuffer(const MessageBuffer&) = delete;
+  MessageBuffer& operator=(const MessageBuffer&) = delete;
+
+  const char* data() const noexcept { return data_; }
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  // Span-like access to the bytes, which stay valid for the lifetime of the handle
+  const char* begin() const noexcept { return data_; }
+  const char* end() const noexcept { return data_ + size_; }
+  const char& operator[](size_type i) const noexcept { return data_[i]; }
+
+  template<typename T>
+  const T* data_as() const noexcept
+  {
+    return reinterpret_cast<const T*>(data_); // NOLINT
+  }
+
+  // Release the owner now rather than on destruction
+  void reset() noexcept
+  {
+    if (release_) {
+      release_(owner_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    owner_ = nullptr;
+    release_ = nullptr;
+  }
+
+private:
+  const char* data_{ nullptr };
+  size_type size_{ 0 };
+  void* owner_{ nullptr };
+  release_fn release_{ nullptr };
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_MESSAGEBUFFER_HPP_
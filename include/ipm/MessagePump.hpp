@@ -0,0 +1,247 @@
+/**
+ * @file MessagePump.hpp MessagePump Class Interface
+ *
+ * MessagePump receives from a Receiver on an I/O thread of its own and
+ * delivers each message to a callback as soon as it arrives, instead of
+ * the caller polling for it. The callback is handed each message as
+ * received, so it may move the MessageBuffers out rather than copy them.
+ * With a queue_capacity of 0 the callback runs on the I/O thread itself;
+ * otherwise the messages are passed through an SPSCRing of that capacity
+ * to a worker thread which runs the callback, so a slow callback doesn't
+ * hold up the transport. If the worker falls behind, the I/O thread sleeps
+ * until there is room in the queue rather than dropping messages.
+ *
+ * The MessagePump shares ownership of the Receiver, and its destructor
+ * stops the threads before letting go of it, so the Receiver is never
+ * destroyed while they are using it. While the pump is running, the
+ * Receiver shouldn't be received from by anything else.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_MESSAGEPUMP_HPP_
+#define IPM_INCLUDE_IPM_MESSAGEPUMP_HPP_
+
+#include "ipm/Receiver.hpp"
+#include "ipm/SPSCRing.hpp"
+#include "ipm/ThreadPlacement.hpp"
+#include "ipm/Wakeup.hpp"
+
+#include "ers/Issue.h"
+#include "ers/ers.h"
+#include "nlohmann/json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, MessagePumpAlreadyStarted, "MessagePump's I/O thread has already been started", )
+ERS_DECLARE_ISSUE(ipm, NoMessageCallback, "MessagePump::start was called before a callback was set with on_message", )
+ERS_DECLARE_ISSUE(ipm, MessageCallbackFailed, "The callback set with MessagePump::on_message threw an exception", )
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class MessagePump
+{
+public:
+  using duration_type = Receiver::duration_type;
+  using size_type = Receiver::size_type;
+  using message_callback_t = std::function<void(Receiver::BufferResponse&)>;
+
+  static constexpr duration_type io_poll_interval = std::chrono::milliseconds(100);
+
+  explicit MessagePump(std::shared_ptr<Receiver> receiver)
+    : receiver_(std::move(receiver))
+  {}
+
+  ~MessagePump() { stop(); }
+
+  const std::shared_ptr<Receiver>& receiver() const noexcept { return receiver_; }
+
+  // -on_message() and start() throw MessagePumpAlreadyStarted if the I/O thread is running
+  // -start() throws NoMessageCallback if on_message() hasn't been called, and
+  //  KnownStateForbidsReceive if the Receiver can't receive
+  // -stop() waits for up to io_poll_interval for the I/O thread to notice, then for the
+  //  worker to deliver whatever is still queued
+  //
+  // is_running() turns false by itself if the Receiver fails, which is reported through
+  // ERS; stop() still has to be called before the pump is started again
+
+  void on_message(message_callback_t callback, size_type queue_capacity = 0);
+  void start();
+  void stop();
+  bool is_running() const noexcept { return running_.load(std::memory_order_acquire); }
+
+  // set_thread_placement() pins the I/O thread to the CPUs listed as "io_thread_cpus",
+  // and the worker to "worker_thread_cpus", when they are next started. Once pinned, the
+  // I/O thread calls the Receiver's move_buffers_to_local_node()
+  // -Throws MessagePumpAlreadyStarted if the I/O thread is running
+
+  void set_thread_placement(const nlohmann::json& placement);
+
+  MessagePump(const MessagePump&) = delete;
+  MessagePump& operator=(const MessagePump&) = delete;
+
+  MessagePump(MessagePump&&) = delete;
+  MessagePump& operator=(MessagePump&&) = delete;
+
+private:
+  void run_io_loop();
+  void run_worker_loop();
+  void deliver(Receiver::BufferResponse& message);
+  void io_finished();
+
+  std::shared_ptr<Receiver> receiver_;
+  message_callback_t callback_;
+  std::vector<int> io_thread_cpus_;
+  std::vector<int> worker_thread_cpus_;
+  std::unique_ptr<SPSCRing<Receiver::BufferResponse>> queue_;
+  std::thread io_thread_;
+  std::thread worker_thread_;
+  std::atomic<bool> running_{ false };
+  std::atomic<bool> io_done_{ false };
+  Wakeup worker_wakeup_; // For the worker, once it finds the queue empty
+  Wakeup io_wakeup_;     // For the I/O thread, once it finds the queue full
+};
+
+inline void
+MessagePump::on_message(message_callback_t callback, size_type queue_capacity)
+{
+  if (io_thread_.joinable()) {
+    throw MessagePumpAlreadyStarted(ERS_HERE);
+  }
+
+  callback_ = std::move(callback);
+  queue_.reset(queue_capacity > 0 ? new SPSCRing<Receiver::BufferResponse>(queue_capacity) : nullptr);
+}
+
+inline void
+MessagePump::set_thread_placement(const nlohmann::json& placement)
+{
+  if (io_thread_.joinable()) {
+    throw MessagePumpAlreadyStarted(ERS_HERE);
+  }
+
+  io_thread_cpus_ = placement::cpus_for(placement, "io_thread_cpus");
+  worker_thread_cpus_ = placement::cpus_for(placement, "worker_thread_cpus");
+}
+
+inline void
+MessagePump::start()
+{
+  if (io_thread_.joinable()) {
+    throw MessagePumpAlreadyStarted(ERS_HERE);
+  }
+  if (!callback_) {
+    throw NoMessageCallback(ERS_HERE);
+  }
+  if (!receiver_ || !receiver_->can_receive()) {
+    throw KnownStateForbidsReceive(ERS_HERE);
+  }
+
+  running_.store(true, std::memory_order_release);
+  io_done_.store(false);
+  if (queue_) {
+    worker_thread_ = std::thread(&MessagePump::run_worker_loop, this);
+  }
+  io_thread_ = std::thread(&MessagePump::run_io_loop, this);
+}
+
+inline void
+MessagePump::stop()
+{
+  if (!io_thread_.joinable()) {
+    return;
+  }
+
+  running_.store(false, std::memory_order_release);
+  io_thread_.join();
+  // The worker only exits once the I/O thread has finished and the queue is empty
+  if (worker_thread_.joinable()) {
+    worker_thread_.join();
+  }
+}
+
+inline void
+MessagePump::run_io_loop()
+{
+  if (!io_thread_cpus_.empty()) {
+    placement::pin_this_thread(io_thread_cpus_);
+    receiver_->move_buffers_to_local_node();
+  }
+  while (running_.load(std::memory_order_acquire)) {
+    auto message = receiver_->try_receive_buffer(io_poll_interval);
+    if (message.ok()) {
+      deliver(message.value);
+    } else if (message.status == Status::Error) {
+      ers::error(ReceiveFailed(ERS_HERE, to_string(message.status)));
+      running_.store(false, std::memory_order_release);
+    }
+  }
+  io_finished();
+}
+
+inline void
+MessagePump::deliver(Receiver::BufferResponse& message)
+{
+  if (!queue_) {
+    try {
+      callback_(message);
+    } catch (std::exception const& ex) {
+      ers::error(MessageCallbackFailed(ERS_HERE, ex));
+    }
+    return;
+  }
+
+  // The worker keeps draining the queue until the I/O thread has finished, so this
+  // gets delivered even if stop() is called meanwhile
+  while (!queue_->try_push(std::move(message))) {
+    io_wakeup_.wait_until(std::chrono::steady_clock::time_point::max(), [this] { return !queue_->full(); });
+  }
+  worker_wakeup_.notify();
+}
+
+// Lets the worker exit once it has emptied the queue
+inline void
+MessagePump::io_finished()
+{
+  io_done_.store(true);
+  worker_wakeup_.notify();
+}
+
+inline void
+MessagePump::run_worker_loop()
+{
+  placement::pin_this_thread(worker_thread_cpus_);
+  Receiver::BufferResponse message;
+  while (true) {
+    if (queue_->try_pop(message)) {
+      io_wakeup_.notify();
+      try {
+        callback_(message);
+      } catch (std::exception const& ex) {
+        ers::error(MessageCallbackFailed(ERS_HERE, ex));
+      }
+      message = Receiver::BufferResponse();
+      continue;
+    }
+
+    if (io_done_.load() && queue_->empty()) {
+      return;
+    }
+    worker_wakeup_.wait_until(std::chrono::steady_clock::time_point::max(),
+                              [this] { return !queue_->empty() || io_done_.load(); });
+  }
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_MESSAGEPUMP_HPP_
@@ -0,0 +1,29 @@
+/**
+ * @file PollHandle.hpp PollHandle struct
+ *
+ * PollHandle says what to wait on for a Receiver or Sender to be ready:
+ * either a ZMQ socket, or a file descriptor which becomes readable or
+ * writable. Transports with neither leave both unset, and can't be
+ * waited on by a ReceiverPoller or Reactor
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_POLLHANDLE_HPP_
+#define IPM_INCLUDE_IPM_POLLHANDLE_HPP_
+
+namespace dunedaq::ipm {
+
+struct PollHandle
+{
+  void* socket{ nullptr };
+  int fd{ -1 };
+
+  bool valid() const noexcept { return socket != nullptr || fd >= 0; }
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_POLLHANDLE_HPP_
@@ -0,0 +1,343 @@
+/**
+ * @file Reactor.hpp Reactor Class Interface
+ *
+ * Reactor is an epoll-based event loop which calls back when a PollHandle
+ * may have become ready, or when a deadline passes. It is what the
+ * coroutine awaitables in Awaitable.hpp (async_receive, async_send)
+ * suspend on, so that many logical streams can share one OS thread
+ *
+ * For ZMQ sockets the Reactor waits on the socket's ZMQ_FD. That file
+ * descriptor only signals that the socket's state may have changed, so
+ * the Reactor reads ZMQ_EVENTS to reset it and the callbacks retry their
+ * operation, asking to keep waiting if it still can't complete. As the
+ * signal is edge-triggered, ZMQ_EVENTS is also checked when a wait
+ * starts, in case the socket is ready already
+ *
+ * There is one Reactor per thread, returned by instance(), and it must
+ * only be used from that thread: the callbacks, and so the coroutines
+ * which are resumed from them, run inside run_once()
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_REACTOR_HPP_
+#define IPM_INCLUDE_IPM_REACTOR_HPP_
+
+#include "ipm/PollHandle.hpp"
+
+#include "ers/Issue.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, ReactorFailed, "Reactor's epoll call failed with errno " << error, ((int)error)) // NOLINT
+ERS_DECLARE_ISSUE(ipm, ReactorCannotWait, "The Reactor was asked to wait on something which can't be polled", )
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class Reactor
+{
+
+public:
+  using clock_type = std::chrono::steady_clock;
+  using duration_type = std::chrono::milliseconds;
+  static constexpr duration_type block = duration_type::max();
+  static constexpr duration_type noblock = duration_type::zero();
+
+  enum class Interest
+  {
+    Readable,
+    Writable,
+  };
+
+  // Called with expired == false when the handle may be ready, and then returns whether
+  // the wait is over; or with expired == true once the deadline has passed, which
+  // always ends the wait
+  using callback_t = std::function<bool(bool expired)>;
+
+  static Reactor& instance()
+  {
+    thread_local Reactor reactor;
+    return reactor;
+  }
+
+  static clock_type::time_point deadline_for(const duration_type& timeout)
+  {
+    auto now = clock_type::now();
+    if (timeout == block ||
+        timeout >= std::chrono::duration_cast<duration_type>(clock_type::time_point::max() - now)) {
+      return clock_type::time_point::max();
+    }
+    return now + timeout;
+  }
+
+  Reactor()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC))
+  {
+    if (epoll_fd_ < 0) {
+      throw ReactorFailed(ERS_HERE, errno);
+    }
+  }
+
+  ~Reactor() { close(epoll_fd_); }
+
+  // -Throws ReactorCannotWait if the handle isn't valid
+  void wait(const PollHandle& handle, Interest interest, clock_type::time_point deadline, callback_t callback);
+
+  // The number of waits which haven't ended yet
+  size_t pending() const noexcept { return waiters_.size(); }
+
+  // run_once() waits up to the timeout, or until the earliest deadline, for any of the
+  // handles to signal, then makes the callbacks for those and for the expired deadlines.
+  // Returns the number of waits which ended
+
+  size_t run_once(const duration_type& timeout);
+
+  // run() makes callbacks until there are no waits left
+  void run()
+  {
+    while (!waiters_.empty()) {
+      run_once(block);
+    }
+  }
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  Reactor(Reactor&&) = delete;
+  Reactor& operator=(Reactor&&) = delete;
+
+private:
+  using waiter_id = uint64_t;
+
+  struct Waiter
+  {
+    int fd;
+    clock_type::time_point deadline;
+    callback_t callback;
+  };
+
+  struct WatchedFd
+  {
+    void* socket{ nullptr }; // Set for a ZMQ socket's ZMQ_FD
+    uint32_t events{ 0 };
+    std::vector<waiter_id> waiters;
+  };
+
+  size_t dispatch(int fd);
+  size_t expire(clock_type::time_point now);
+  void remove_waiter(waiter_id id);
+  void update_registration(int fd);
+
+  int epoll_fd_;
+  waiter_id next_id_{ 0 };
+  std::unordered_map<waiter_id, Waiter> waiters_;
+  std::unordered_map<int, WatchedFd> fds_;
+  std::multimap<clock_type::time_point, waiter_id> deadlines_; // Only for waits with a deadline
+  std::vector<int> ready_fds_;                                 // ZMQ sockets found ready by wait()
+};
+
+inline void
+Reactor::wait(const PollHandle& handle, Interest interest, clock_type::time_point deadline, callback_t callback)
+{
+  if (!handle.valid()) {
+    throw ReactorCannotWait(ERS_HERE);
+  }
+
+  int fd = handle.fd;
+  uint32_t events = interest == Interest::Readable ? EPOLLIN : EPOLLOUT;
+  if (handle.socket) {
+    // ZMQ_FD signals readable for any change in the socket's state
+    size_t fd_size = sizeof(fd);
+    if (zmq_getsockopt(handle.socket, ZMQ_FD, &fd, &fd_size) != 0) {
+      throw ReactorFailed(ERS_HERE, zmq_errno());
+    }
+    events = EPOLLIN;
+
+    int zmq_events = 0;
+    size_t zmq_events_size = sizeof(zmq_events);
+    zmq_getsockopt(handle.socket, ZMQ_EVENTS, &zmq_events, &zmq_events_size);
+    if (zmq_events & (interest == Interest::Readable ? ZMQ_POLLIN : ZMQ_POLLOUT)) {
+      ready_fds_.push_back(fd);
+    }
+  }
+
+  auto id = next_id_++;
+  waiters_.emplace(id, Waiter{ fd, deadline, std::move(callback) });
+  if (deadline != clock_type::time_point::max()) {
+    deadlines_.emplace(deadline, id);
+  }
+
+  auto& watched = fds_[fd];
+  watched.socket = handle.socket;
+  watched.events |= events;
+  watched.waiters.push_back(id);
+  update_registration(fd);
+}
+
+inline size_t
+Reactor::run_once(const duration_type& timeout)
+{
+  auto now = clock_type::now();
+  auto wait_until = deadline_for(timeout);
+  if (!deadlines_.empty()) {
+    wait_until = std::min(wait_until, deadlines_.begin()->first);
+  }
+
+  // epoll_wait takes a timeout in milliseconds, with -1 meaning "wait forever"
+  int timeout_in_ms = -1;
+  if (!ready_fds_.empty()) {
+    timeout_in_ms = 0;
+  } else if (wait_until != clock_type::time_point::max()) {
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(std::max(wait_until - now, clock_type::duration::zero()));
+    timeout_in_ms = static_cast<int>(std::min<std::chrono::milliseconds::rep>(remaining.count(), std::numeric_limits<int>::max()));
+  }
+
+  constexpr int max_events = 64;
+  epoll_event events[max_events];
+  int nevents = epoll_wait(epoll_fd_, events, max_events, timeout_in_ms);
+  if (nevents < 0) {
+    if (errno != EINTR) {
+      throw ReactorFailed(ERS_HERE, errno);
+    }
+    nevents = 0;
+  }
+
+  size_t completed = 0;
+  auto ready_fds = std::move(ready_fds_);
+  ready_fds_.clear();
+  for (auto fd : ready_fds) {
+    completed += dispatch(fd);
+  }
+  for (int i = 0; i < nevents; ++i) {
+    completed += dispatch(events[i].data.fd);
+  }
+  completed += expire(clock_type::now());
+  return completed;
+}
+
+inline size_t
+Reactor::dispatch(int fd)
+{
+  auto watched = fds_.find(fd);
+  if (watched == fds_.end()) {
+    return 0;
+  }
+
+  if (watched->second.socket) {
+    // Reading ZMQ_EVENTS is what resets ZMQ_FD's signal
+    int zmq_events = 0;
+    size_t zmq_events_size = sizeof(zmq_events);
+    zmq_getsockopt(watched->second.socket, ZMQ_EVENTS, &zmq_events, &zmq_events_size);
+  }
+
+  // The callbacks may resume coroutines which start new waits, possibly on the same fd,
+  // so the current waiters are taken out first and nothing is held across the calls
+  auto ready = std::move(watched->second.waiters);
+  watched->second.waiters.clear();
+
+  size_t completed = 0;
+  std::vector<waiter_id> still_waiting;
+  for (auto id : ready) {
+    auto waiter = waiters_.find(id);
+    if (waiter == waiters_.end()) {
+      continue;
+    }
+    auto callback = std::move(waiter->second.callback);
+    if (callback(false)) {
+      remove_waiter(id);
+      ++completed;
+    } else {
+      waiters_.at(id).callback = std::move(callback);
+      still_waiting.push_back(id);
+    }
+  }
+
+  auto& waiters = fds_[fd].waiters;
+  waiters.insert(waiters.begin(), still_waiting.begin(), still_waiting.end());
+  update_registration(fd);
+  return completed;
+}
+
+inline size_t
+Reactor::expire(clock_type::time_point now)
+{
+  size_t completed = 0;
+  while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+    auto id = deadlines_.begin()->second;
+    auto waiter = waiters_.find(id);
+    auto callback = std::move(waiter->second.callback);
+    auto fd = waiter->second.fd;
+    remove_waiter(id);
+
+    auto& fd_waiters = fds_[fd].waiters;
+    fd_waiters.erase(std::remove(fd_waiters.begin(), fd_waiters.end(), id), fd_waiters.end());
+    update_registration(fd);
+
+    callback(true);
+    ++completed;
+  }
+  return completed;
+}
+
+inline void
+Reactor::remove_waiter(waiter_id id)
+{
+  auto waiter = waiters_.find(id);
+  if (waiter->second.deadline != clock_type::time_point::max()) {
+    auto range = deadlines_.equal_range(waiter->second.deadline);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == id) {
+        deadlines_.erase(it);
+        break;
+      }
+    }
+  }
+  waiters_.erase(waiter);
+}
+
+// An fd is only registered with epoll while something is waiting on it, as a closed
+// socket's fd number may be reused
+inline void
+Reactor::update_registration(int fd)
+{
+  auto watched = fds_.find(fd);
+  if (watched == fds_.end()) {
+    return;
+  }
+
+  if (watched->second.waiters.empty()) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    fds_.erase(watched);
+    return;
+  }
+
+  epoll_event event{};
+  event.events = watched->second.events;
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) != 0) {
+    if (errno != ENOENT || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      throw ReactorFailed(ERS_HERE, errno);
+    }
+  }
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_REACTOR_HPP_
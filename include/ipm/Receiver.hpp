@@ -14,6 +14,12 @@
  *
  * - Meaningfully implement the timeout feature in receive_, and have it
  *   throw the ReceiveTimeoutExpired exception if it occurs
+ * - Override the protected virtual receive_buffer_ function if the
+ *   transport can hand out received messages without copying them
+ * - Override the protected virtual try_receive_ and try_receive_buffer_
+ *   functions so that a timeout is reported without throwing
+ * - Override the public virtual poll_handle function so the Receiver
+ *   can be used with a ReceiverPoller
  *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
@@ -23,14 +29,22 @@
 #ifndef IPM_INCLUDE_IPM_RECEIVER_HPP_
 #define IPM_INCLUDE_IPM_RECEIVER_HPP_
 
+#include "ipm/MessageBuffer.hpp"
+#include "ipm/PollHandle.hpp"
+#include "ipm/Status.hpp"
+
 #include "ers/Issue.h"
+#include "ers/ers.h"
 #include "nlohmann/json.hpp"
 
 #include <cetlib/BasicPluginFactory.h>
 #include <cetlib/compiler_macros.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -39,10 +53,12 @@ ERS_DECLARE_ISSUE(ipm,
                   UnexpectedNumberOfBytes,
                   "Expected " << bytes1 << " bytes in message but received " << bytes2,
                   ((int)bytes1)((int)bytes2)) // NOLINT
+ERS_DECLARE_ISSUE(ipm, NullPointerPassedToReceive, "An null pointer to memory was passed to Receiver::receive_into", )
 ERS_DECLARE_ISSUE(ipm,
                   ReceiveTimeoutExpired,
                   "Unable to receive within timeout period (timeout period was " << timeout << " milliseconds)",
                   ((int)timeout)) // NOLINT
+ERS_DECLARE_ISSUE(ipm, ReceiveFailed, "Receive failed with status " << status, ((std::string)status))
 } // namespace dunedaq
 
 #ifndef EXTERN_C_FUNC_DECLARE_START
@@ -67,8 +83,8 @@ class Receiver
 
 public:
   using duration_type = std::chrono::milliseconds;
-  static constexpr duration_type block = std::chrono::duration_values<duration_type>::max();
-  static constexpr duration_type noblock = std::chrono::duration_values<duration_type>::zero();
+  static constexpr duration_type block = duration_type::max();
+  static constexpr duration_type noblock = duration_type::zero();
 
   using size_type = int;
   static constexpr size_type anysize =
@@ -93,6 +109,90 @@ public:
 
   Response receive(const duration_type& timeout, size_type nbytes = anysize);
 
+  // receive_buffer() performs the same checks as receive(), but the metadata and data
+  // are handed out as MessageBuffers which may refer directly to the transport's
+  // storage instead of being copied out of it. A timeout is reported as by receive()
+
+  struct BufferResponse
+  {
+    MessageBuffer metadata{};
+    MessageBuffer data{};
+  };
+
+  BufferResponse receive_buffer(const duration_type& timeout, size_type nbytes = anysize);
+
+  // receive_multipart() returns each part of a message sent with Sender::send_multipart
+  // as a separate MessageBuffer. Messages sent with Sender::send arrive as one part, and
+  // a timeout is reported as by receive(). receive() and receive_buffer() join the parts
+
+  struct MultipartResponse
+  {
+    MessageBuffer metadata{};
+    std::vector<MessageBuffer> data{};
+  };
+
+  MultipartResponse receive_multipart(const duration_type& timeout);
+
+  // try_receive() and try_receive_buffer() report a timeout, an interruption or a
+  // transport error through the returned status rather than by throwing, so a loop
+  // polling with a short timeout doesn't pay for an exception each time nothing arrives.
+  // KnownStateForbidsReceive is still thrown if can_receive() == false, as that is a
+  // usage error rather than an outcome of the receive
+
+  Result<Response> try_receive(const duration_type& timeout);
+
+  Result<BufferResponse> try_receive_buffer(const duration_type& timeout);
+
+  // receive_into() writes the data straight into a caller-owned buffer, so that a loop
+  // reusing the same buffer doesn't allocate per message. The size reported is that of
+  // the whole message; if it exceeds the capacity, only the first "capacity" bytes were
+  // written and "truncated" is set. A timeout gives a size of 0. The metadata is
+  // assigned to *metadata, if given, which reuses the string's storage
+  // -Throws KnownStateForbidsReceive if can_receive() == false
+  // -Throws NullPointerPassedToReceive if buffer is a null pointer and capacity isn't 0
+  // -Throws ReceiveFailed if the transport fails
+
+  struct ReceiveIntoResponse
+  {
+    size_type size{ 0 };
+    bool truncated{ false };
+  };
+
+  ReceiveIntoResponse receive_into(void* buffer,
+                                   size_type capacity,
+                                   const duration_type& timeout,
+                                   std::string* metadata = nullptr);
+
+  // receive_batch() waits up to the timeout for the first message only, then takes
+  // whatever further messages are already available without waiting, up to
+  // max_messages in all. "messages" is cleared first, so reusing the same vector
+  // across calls avoids reallocating it. Returns the number of messages received,
+  // which is 0 if the timeout expired
+
+  size_type receive_batch(std::vector<BufferResponse>& messages,
+                          size_type max_messages,
+                          const duration_type& timeout);
+
+  // poll_handle() says what to wait on for this Receiver to have a message, so that a
+  // ReceiverPoller can wait on many Receivers at once. Transports which can't be
+  // polled return the default, invalid, handle
+
+  virtual PollHandle poll_handle() noexcept { return PollHandle(); }
+
+  // statistics() reports whatever counters the transport keeps, as a JSON object whose
+  // keys depend on the implementation. It may be called while another thread is receiving
+
+  virtual nlohmann::json statistics() const { return nlohmann::json::object(); }
+
+  // move_buffers_to_local_node() is called by a thread which is about to do the
+  // receiving, once it has been pinned to its CPUs, e.g. by a MessagePump's I/O thread.
+  // Implementations which read into buffers of their own can move them to the thread's
+  // NUMA node with placement::move_to_local_node
+
+  virtual void move_buffers_to_local_node() {}
+
+  virtual ~Receiver() = default;
+
   Receiver(const Receiver&) = delete;
   Receiver& operator=(const Receiver&) = delete;
 
@@ -101,14 +201,129 @@ public:
 
 protected:
   virtual Response receive_(const duration_type& timeout) = 0;
+
+  // Default implementation turns the timeout reported by receive_ into a status. Only
+  // ReceiveTimeoutExpired is a timeout, as a message may have no payload at all
+  virtual Result<Response> try_receive_(const duration_type& timeout)
+  {
+    Result<Response> result;
+    try {
+      result.value = receive_(timeout);
+      result.status = Status::Ok;
+    } catch (ReceiveTimeoutExpired const&) {
+      result.status = Status::Timeout;
+    }
+    return result;
+  }
+
+  // Default implementation hands out the result of receive_ without any further copies
+  virtual BufferResponse receive_buffer_(const duration_type& timeout)
+  {
+    auto response = receive_(timeout);
+    BufferResponse output;
+    if (!response.metadata.empty()) {
+      output.metadata = MessageBuffer::adopt(std::move(response.metadata));
+    }
+    if (!response.data.empty()) {
+      output.data = MessageBuffer::adopt(std::move(response.data));
+    }
+    return output;
+  }
+
+  virtual Result<BufferResponse> try_receive_buffer_(const duration_type& timeout)
+  {
+    Result<BufferResponse> result;
+    try {
+      result.value = receive_buffer_(timeout);
+      result.status = Status::Ok;
+    } catch (ReceiveTimeoutExpired const&) {
+      result.status = Status::Timeout;
+    }
+    return result;
+  }
+
+  // Default implementation copies out of the result of try_receive_buffer_
+  virtual ReceiveIntoResponse receive_into_(void* buffer,
+                                            size_type capacity,
+                                            const duration_type& timeout,
+                                            std::string* metadata)
+  {
+    auto response = try_receive_buffer_(timeout);
+    ReceiveIntoResponse output;
+    if (response.status == Status::Timeout) {
+      return output;
+    }
+    check_status(response.status, timeout);
+    output.size = response->data.size();
+    output.truncated = output.size > capacity;
+    std::copy(response->data.begin(), response->data.begin() + std::min(output.size, capacity), static_cast<char*>(buffer));
+    if (metadata) {
+      metadata->assign(response->metadata.begin(), response->metadata.end());
+    }
+    return output;
+  }
+
+  // Default implementation makes one try_receive_buffer_ call per message
+  virtual size_type receive_batch_(std::vector<BufferResponse>& messages,
+                                   size_type max_messages,
+                                   const duration_type& timeout)
+  {
+    auto next_timeout = timeout;
+    while (static_cast<size_type>(messages.size()) < max_messages) {
+      auto message = try_receive_buffer_(next_timeout);
+      if (!message) {
+        // Once some messages have been received they're handed out, and any error
+        // will be seen again by the next call
+        if (messages.empty() && message.status != Status::Timeout) {
+          check_status(message.status, timeout);
+        }
+        break;
+      }
+      messages.push_back(std::move(message.value));
+      next_timeout = noblock;
+    }
+    return static_cast<size_type>(messages.size());
+  }
+
+  // Default implementation returns each message as a single part
+  virtual MultipartResponse receive_multipart_(const duration_type& timeout)
+  {
+    auto response = receive_buffer_(timeout);
+    MultipartResponse output;
+    output.metadata = std::move(response.metadata);
+    if (!response.data.empty()) {
+      output.data.push_back(std::move(response.data));
+    }
+    return output;
+  }
+
+  // For implementations whose throwing calls are built on their try_ counterparts:
+  // throws the exception matching a status other than Ok
+  static void check_status(Status status, const duration_type& timeout)
+  {
+    switch (status) {
+      case Status::Ok:
+        return;
+      case Status::Timeout:
+        throw ReceiveTimeoutExpired(ERS_HERE, timeout.count());
+      default:
+        throw ReceiveFailed(ERS_HERE, to_string(status));
+    }
+  }
+
+private:
+  void check_can_receive() const
+  {
+    if (!can_receive()) {
+      throw KnownStateForbidsReceive(ERS_HERE);
+    }
+  }
 };
 
 inline Receiver::Response
 Receiver::receive(const duration_type& timeout, size_type bytes)
 {
-  if (!can_receive()) {
-    throw KnownStateForbidsReceive(ERS_HERE);
-  }
+  check_can_receive();
   auto message = receive_(timeout);
 
   if (bytes != anysize) {
@@ -121,6 +336,68 @@ Receiver::receive(const duration_type& timeout, size_type bytes)
   return message;
 }
 
+inline Receiver::BufferResponse
+Receiver::receive_buffer(const duration_type& timeout, size_type bytes)
+{
+  check_can_receive();
+  auto message = receive_buffer_(timeout);
+
+  if (bytes != anysize) {
+    auto received_size = message.data.size();
+    if (received_size != bytes) {
+      throw UnexpectedNumberOfBytes(ERS_HERE, received_size, bytes);
+    }
+  }
+
+  return message;
+}
+
+inline Result<Receiver::Response>
+Receiver::try_receive(const duration_type& timeout)
+{
+  check_can_receive();
+  return try_receive_(timeout);
+}
+
+inline Result<Receiver::BufferResponse>
+Receiver::try_receive_buffer(const duration_type& timeout)
+{
+  check_can_receive();
+  return try_receive_buffer_(timeout);
+}
+
+inline Receiver::MultipartResponse
+Receiver::receive_multipart(const duration_type& timeout)
+{
+  check_can_receive();
+  return receive_multipart_(timeout);
+}
+
+inline Receiver::ReceiveIntoResponse
+Receiver::receive_into(void* buffer, size_type capacity, const duration_type& timeout, std::string* metadata)
+{
+  check_can_receive();
+
+  if (!buffer && capacity != 0) {
+    throw NullPointerPassedToReceive(ERS_HERE);
+  }
+
+  return receive_into_(buffer, capacity, timeout, metadata);
+}
+
+inline Receiver::size_type
+Receiver::receive_batch(std::vector<BufferResponse>& messages, size_type max_messages, const duration_type& timeout)
+{
+  check_can_receive();
+
+  messages.clear();
+  if (max_messages <= 0) {
+    return 0;
+  }
+
+  return receive_batch_(messages, max_messages, timeout);
+}
+
 std::shared_ptr<Receiver>
 makeIPMReceiver(std::string const& plugin_name)
 {
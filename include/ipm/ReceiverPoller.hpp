@@ -0,0 +1,192 @@
+/**
+ * @file ReceiverPoller.hpp ReceiverPoller Class Interface
+ *
+ * ReceiverPoller waits on many Receivers (and so Subscribers) at once,
+ * so that a single thread can service many inputs instead of each one
+ * needing a thread which blocks in receive. Receivers are registered
+ * with an optional callback; poll() hands back the ones which have a
+ * message waiting, and dispatch() invokes their callbacks
+ *
+ * The waiting is done by zmq_poll on each Receiver's poll_handle(), so
+ * only Receivers which provide one can be registered. As ZMQ sockets
+ * aren't thread-safe, the poller should be used from the thread which
+ * then receives from the readable Receivers
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_RECEIVERPOLLER_HPP_
+#define IPM_INCLUDE_IPM_RECEIVERPOLLER_HPP_
+
+#include "ipm/Receiver.hpp"
+
+#include "ers/Issue.h"
+
+#include <zmq.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, ReceiverNotPollable, "Receiver does not provide a handle which can be polled", )
+ERS_DECLARE_ISSUE(ipm, ReceiverPollFailed, "Polling Receivers failed with errno " << error, ((int)error)) // NOLINT
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class ReceiverPoller
+{
+
+public:
+  using duration_type = Receiver::duration_type;
+  static constexpr duration_type block = Receiver::block;
+  static constexpr duration_type noblock = Receiver::noblock;
+
+  using callback_t = std::function<void(Receiver&)>;
+
+  ReceiverPoller() = default;
+
+  // -Throws ReceiverNotPollable if the Receiver doesn't provide a valid poll_handle().
+  // Adding a Receiver which is already registered replaces its callback
+  void add(std::shared_ptr<Receiver> receiver, callback_t callback = nullptr);
+
+  // Returns false if the Receiver wasn't registered
+  bool remove(const std::shared_ptr<Receiver>& receiver);
+
+  size_t size() const noexcept { return receivers_.size(); }
+  bool empty() const noexcept { return receivers_.empty(); }
+
+  // poll() waits up to the timeout for at least one of the registered Receivers to have
+  // a message, then puts all those which do into "ready", which is cleared first.
+  // Returns the number of ready Receivers, which is 0 if the timeout expired or the
+  // wait was interrupted by a signal
+  // -Throws ReceiverPollFailed if zmq_poll fails for any other reason
+
+  size_t poll(std::vector<std::shared_ptr<Receiver>>& ready, const duration_type& timeout);
+
+  // dispatch() polls as above, then calls the callback of each ready Receiver which has
+  // one. The callbacks shouldn't add or remove Receivers. Returns the number of
+  // Receivers which were ready
+
+  size_t dispatch(const duration_type& timeout);
+
+  ReceiverPoller(const ReceiverPoller&) = delete;
+  ReceiverPoller& operator=(const ReceiverPoller&) = delete;
+
+  ReceiverPoller(ReceiverPoller&&) = default;
+  ReceiverPoller& operator=(ReceiverPoller&&) = default;
+
+private:
+  // Polls and marks the items which are readable, returning how many there are
+  size_t poll_items(const duration_type& timeout);
+
+  // The three vectors are kept in step, so that items_ can be passed to zmq_poll as is
+  std::vector<std::shared_ptr<Receiver>> receivers_;
+  std::vector<callback_t> callbacks_;
+  std::vector<zmq_pollitem_t> items_;
+};
+
+inline void
+ReceiverPoller::add(std::shared_ptr<Receiver> receiver, callback_t callback)
+{
+  auto handle = receiver ? receiver->poll_handle() : PollHandle();
+  if (!handle.valid()) {
+    throw ReceiverNotPollable(ERS_HERE);
+  }
+
+  auto existing = std::find(receivers_.begin(), receivers_.end(), receiver);
+  if (existing != receivers_.end()) {
+    callbacks_[existing - receivers_.begin()] = std::move(callback);
+    return;
+  }
+
+  zmq_pollitem_t item = { handle.socket, handle.fd, ZMQ_POLLIN, 0 };
+  receivers_.push_back(std::move(receiver));
+  callbacks_.push_back(std::move(callback));
+  items_.push_back(item);
+}
+
+inline bool
+ReceiverPoller::remove(const std::shared_ptr<Receiver>& receiver)
+{
+  auto existing = std::find(receivers_.begin(), receivers_.end(), receiver);
+  if (existing == receivers_.end()) {
+    return false;
+  }
+
+  auto index = existing - receivers_.begin();
+  receivers_.erase(existing);
+  callbacks_.erase(callbacks_.begin() + index);
+  items_.erase(items_.begin() + index);
+  return true;
+}
+
+inline size_t
+ReceiverPoller::poll(std::vector<std::shared_ptr<Receiver>>& ready, const duration_type& timeout)
+{
+  ready.clear();
+  auto nready = poll_items(timeout);
+  for (size_t i = 0; i < items_.size() && ready.size() < nready; ++i) {
+    if (items_[i].revents & ZMQ_POLLIN) {
+      ready.push_back(receivers_[i]);
+    }
+  }
+  return nready;
+}
+
+inline size_t
+ReceiverPoller::dispatch(const duration_type& timeout)
+{
+  auto nready = poll_items(timeout);
+  size_t seen = 0;
+  for (size_t i = 0; i < items_.size() && seen < nready; ++i) {
+    if (items_[i].revents & ZMQ_POLLIN) {
+      ++seen;
+      if (callbacks_[i]) {
+        callbacks_[i](*receivers_[i]);
+      }
+    }
+  }
+  return nready;
+}
+
+inline size_t
+ReceiverPoller::poll_items(const duration_type& timeout)
+{
+  // zmq_poll takes a timeout in milliseconds, with -1 meaning "wait forever"
+  long timeout_in_ms = -1;
+  if (timeout != block) {
+    timeout_in_ms = static_cast<long>(std::min<duration_type::rep>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count(), std::numeric_limits<long>::max()));
+  }
+
+  int rc = zmq_poll(items_.data(), static_cast<int>(items_.size()), timeout_in_ms);
+  if (rc < 0) {
+    if (zmq_errno() == EINTR) {
+      return 0;
+    }
+    throw ReceiverPollFailed(ERS_HERE, zmq_errno());
+  }
+
+  // zmq_poll's count includes items with only ZMQ_POLLERR set, which have nothing to read
+  size_t nready = 0;
+  for (size_t i = 0; i < items_.size() && rc > 0; ++i) {
+    if (items_[i].revents != 0) {
+      --rc;
+      nready += (items_[i].revents & ZMQ_POLLIN) != 0;
+    }
+  }
+  return nready;
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_RECEIVERPOLLER_HPP_
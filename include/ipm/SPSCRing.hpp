@@ -0,0 +1,107 @@
+/**
+ * @file SPSCRing.hpp SPSCRing Class Interface
+ *
+ * SPSCRing is a bounded, lock-free queue for handing objects from exactly
+ * one producer thread to exactly one consumer thread. The capacity is
+ * rounded up to a power of two, and the producer and consumer indices
+ * live on separate cache lines so the two threads don't contend for them
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_SPSCRING_HPP_
+#define IPM_INCLUDE_IPM_SPSCRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace dunedaq::ipm {
+
+template<typename T>
+class SPSCRing
+{
+
+public:
+  static constexpr size_t cache_line_size = 64;
+
+  explicit SPSCRing(size_t capacity)
+    : capacity_(round_up_to_power_of_two(capacity))
+    , mask_(capacity_ - 1)
+    , slots_(new T[capacity_])
+  {}
+
+  size_t capacity() const noexcept { return capacity_; }
+
+  // Producer side: returns false, leaving "item" untouched, if the ring is full
+  bool try_push(T&& item)
+  {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == capacity_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == capacity_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: returns false if the ring is empty
+  bool try_pop(T& item)
+  {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only exact when called from the producer or consumer thread while the other is idle
+  bool empty() const noexcept { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+  bool full() const noexcept
+  {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) == capacity_;
+  }
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  SPSCRing(SPSCRing&&) = delete;
+  SPSCRing& operator=(SPSCRing&&) = delete;
+
+private:
+  static size_t round_up_to_power_of_two(size_t n)
+  {
+    size_t result = 1;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // Written by the consumer; head_cache_ is the producer's last view of it
+  alignas(cache_line_size) std::atomic<size_t> head_{ 0 };
+  alignas(cache_line_size) size_t head_cache_{ 0 };
+
+  // Written by the producer; tail_cache_ is the consumer's last view of it
+  alignas(cache_line_size) std::atomic<size_t> tail_{ 0 };
+  alignas(cache_line_size) size_t tail_cache_{ 0 };
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_SPSCRING_HPP_
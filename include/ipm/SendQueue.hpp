@@ -0,0 +1,223 @@
+/**
+ * @file SendQueue.hpp SendQueue Class Interface
+ *
+ * SendQueue is the queue and owner thread behind SharedSender and
+ * ZmqSender's async mode. Producers on any thread push their messages onto
+ * a lock-free MPSCQueue and return, and the owner thread, which alone uses
+ * the transport, takes them off in runs of up to batch_size and hands each
+ * run to the send function it was started with. A producer only waits if
+ * the owner thread has fallen a whole queue behind, and then sleeps until
+ * the owner thread makes room or its message's deadline passes.
+ *
+ * The send function reports what became of each message: through its
+ * promise, if it came from send_async(), or otherwise through ERS. Once
+ * stop() has been called, whatever is still queued gets a single attempt
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_SENDQUEUE_HPP_
+#define IPM_INCLUDE_IPM_SENDQUEUE_HPP_
+
+#include "ipm/MPSCQueue.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/ThreadPlacement.hpp"
+#include "ipm/Wakeup.hpp"
+
+#include "ers/Issue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, SendQueueAlreadyStarted, "SendQueue's owner thread has already been started", )
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class SendQueue
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+  using duration_type = Sender::duration_type;
+  using size_type = Sender::size_type;
+
+  // A message waiting in the queue for the owner thread
+  struct PendingSend
+  {
+    std::vector<MessageBuffer> parts;
+    std::string topic;
+    clock_type::time_point deadline;
+    bool multipart{ false };
+    std::unique_ptr<std::promise<Status>> promise; // Only set by push_async
+  };
+
+  // Called on the owner thread with each run of queued messages
+  using send_function_t = std::function<void(std::vector<PendingSend>&)>;
+
+  SendQueue() = default;
+
+  ~SendQueue() { stop(); }
+
+  // -start() throws SendQueueAlreadyStarted if the owner thread is running. The thread is
+  //  pinned to "cpus", if any are given
+  // -stop() waits for the owner thread to send whatever is still queued
+  //
+  // Neither may be called while other threads might be pushing, as they make and destroy
+  // the queue; running() is only true in between
+
+  void start(size_t capacity, size_t batch_size, std::vector<int> cpus, send_function_t send);
+  void stop();
+  bool running() const noexcept { return queue_ != nullptr; }
+
+  // For the send function: true once stop() has been called
+  bool stopping() const noexcept { return stopping_.load(); }
+
+  // Waits for room in the queue until the message's deadline, leaving "pending" untouched
+  // if it couldn't be queued
+  Status push(PendingSend&& pending);
+
+  // The future gives the status the send function sets, or why the message wasn't queued
+  std::future<Status> push_async(PendingSend&& pending);
+
+  static PendingSend make_pending(const duration_type& timeout, std::string const& topic)
+  {
+    PendingSend pending;
+    pending.topic = topic;
+    pending.deadline = deadline_for(timeout);
+    return pending;
+  }
+
+  // The caller keeps its buffer, so a queued message needs its own copy
+  static MessageBuffer copy(const void* message, size_type N)
+  {
+    auto bytes = static_cast<const char*>(message);
+    return MessageBuffer::adopt(std::vector<char>(bytes, bytes + N));
+  }
+
+  static clock_type::time_point deadline_for(const duration_type& timeout)
+  {
+    auto now = clock_type::now();
+    if (timeout == Sender::block ||
+        timeout >= std::chrono::duration_cast<duration_type>(clock_type::time_point::max() - now)) {
+      return clock_type::time_point::max();
+    }
+    return now + timeout;
+  }
+
+  static duration_type timeout_for(clock_type::time_point deadline)
+  {
+    if (deadline == clock_type::time_point::max()) {
+      return Sender::block;
+    }
+    return std::max(Sender::noblock, std::chrono::ceil<duration_type>(deadline - clock_type::now()));
+  }
+
+  SendQueue(const SendQueue&) = delete;
+  SendQueue& operator=(const SendQueue&) = delete;
+
+  SendQueue(SendQueue&&) = delete;
+  SendQueue& operator=(SendQueue&&) = delete;
+
+private:
+  void run();
+
+  std::unique_ptr<MPSCQueue<PendingSend>> queue_;
+  size_t batch_size_{ 1 };
+  send_function_t send_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{ false };
+  Wakeup wakeup_; // For the owner thread, once it finds the queue empty
+  Wakeup room_;   // For producers, once they find the queue full
+};
+
+inline void
+SendQueue::start(size_t capacity, size_t batch_size, std::vector<int> cpus, send_function_t send)
+{
+  if (thread_.joinable()) {
+    throw SendQueueAlreadyStarted(ERS_HERE);
+  }
+
+  queue_ = std::make_unique<MPSCQueue<PendingSend>>(capacity);
+  batch_size_ = std::max<size_t>(1, batch_size);
+  send_ = std::move(send);
+  stopping_.store(false);
+  thread_ = std::thread([this, cpus = std::move(cpus)] {
+    placement::pin_this_thread(cpus);
+    run();
+  });
+}
+
+inline void
+SendQueue::stop()
+{
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_.store(true);
+  wakeup_.notify();
+  thread_.join();
+  queue_.reset();
+}
+
+inline Status
+SendQueue::push(PendingSend&& pending)
+{
+  while (!queue_->try_push(std::move(pending))) {
+    if (!room_.wait_until(pending.deadline, [this] { return !queue_->full(); })) {
+      return Status::Timeout;
+    }
+  }
+  wakeup_.notify();
+  return Status::Ok;
+}
+
+inline std::future<Status>
+SendQueue::push_async(PendingSend&& pending)
+{
+  pending.promise = std::make_unique<std::promise<Status>>();
+  auto future = pending.promise->get_future();
+  auto status = push(std::move(pending));
+  if (status != Status::Ok) {
+    // The queue stayed full, so the message never left our hands
+    pending.promise->set_value(status);
+  }
+  return future;
+}
+
+inline void
+SendQueue::run()
+{
+  std::vector<PendingSend> batch;
+  PendingSend pending;
+  while (true) {
+    while (batch.size() < batch_size_ && queue_->try_pop(pending)) {
+      batch.push_back(std::move(pending));
+    }
+    if (!batch.empty()) {
+      room_.notify();
+      send_(batch);
+      batch.clear();
+      continue;
+    }
+
+    if (stopping_.load() && queue_->empty()) {
+      return;
+    }
+    wakeup_.wait_until(clock_type::time_point::max(), [this] { return !queue_->empty() || stopping_.load(); });
+  }
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_SENDQUEUE_HPP_
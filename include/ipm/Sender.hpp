@@ -14,6 +14,10 @@
  *
  * - Meaningfully implement the timeout feature in send_, and have it
  *   throw the SendTimeoutExpired exception if it occurs
+ * - Override the protected virtual send_buffer_ function if the
+ *   transport can take ownership of a message instead of copying it
+ * - Override the protected virtual try_send_ function so that a timeout
+ *   is reported without throwing
  *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
@@ -23,14 +27,23 @@
 #ifndef IPM_INCLUDE_IPM_SENDER_HPP_
 #define IPM_INCLUDE_IPM_SENDER_HPP_
 
+#include "ipm/MessageBuffer.hpp"
+#include "ipm/PollHandle.hpp"
+#include "ipm/Status.hpp"
+
 #include "ers/Issue.h"
 #include "nlohmann/json.hpp"
 
 #include <cetlib/BasicPluginFactory.h>
 #include <cetlib/compiler_macros.h>
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dunedaq {
@@ -40,6 +53,7 @@ ERS_DECLARE_ISSUE(ipm,
                   SendTimeoutExpired,
                   "Unable to send within timeout period (timeout period was " << timeout << " milliseconds)",
                   ((int)timeout)) // NOLINT
+ERS_DECLARE_ISSUE(ipm, SendFailed, "Send failed with status " << status, ((std::string)status))
 
 } // namespace dunedaq
 
@@ -65,12 +79,13 @@ class Sender
 
 public:
   using duration_type = std::chrono::milliseconds;
-  static constexpr duration_type block = std::chrono::duration_values<duration_type>::max();
-  static constexpr duration_type noblock = std::chrono::duration_values<duration_type>::zero();
+  static constexpr duration_type block = duration_type::max();
+  static constexpr duration_type noblock = duration_type::zero();
 
   using size_type = int;
 
   Sender() = default;
+  virtual ~Sender() = default;
 
   virtual void connect_for_sends(const nlohmann::json& connection_info) = 0;
 
@@ -91,6 +106,62 @@ public:
                       const duration_type& timeout,
                       std::string const& metadata = "");
 
+  // try_send() makes the same checks as send(), and throws in the same way if they
+  // fail, but reports a timeout, an interruption or a transport error through the
+  // returned status rather than by throwing. A message of size 0 gives Status::Ok
+
+  Status try_send(const void* message,
+                  size_type message_size,
+                  const duration_type& timeout,
+                  std::string const& metadata = "");
+
+  // This overload takes ownership of the message, so transports which support it can
+  // pass the bytes on without copying them. The MessageBuffer's owner is released once
+  // the transport is done with it, which may be after send() returns and on another
+  // thread. The same checks are made as above, and the message is released if they fail
+
+  void send(MessageBuffer message, const duration_type& timeout, std::string const& metadata = "");
+
+  // send_multipart() sends the parts as one logical message where the transport supports
+  // it, so that the receiver gets them together from Receiver::receive_multipart(). This
+  // overload takes ownership of the parts, as with send(MessageBuffer, ...) above
+
+  void send_multipart(std::vector<MessageBuffer> message_parts,
+                      const duration_type& timeout,
+                      std::string const& metadata = "");
+
+  // send_async() takes ownership of the message as send(MessageBuffer, ...) does, and
+  // returns a future which becomes ready with the outcome of the send: Status::Ok once
+  // the transport has taken the message, otherwise why it couldn't. Transports with an
+  // asynchronous mode return straight away; by default the message is sent before
+  // send_async() returns, so the future is already ready. The checks are those of
+  // send(), which throw as usual
+
+  std::future<Status> send_async(MessageBuffer message,
+                                 const duration_type& timeout,
+                                 std::string const& metadata = "");
+
+  // send_batch() sends many independent messages in one call, with the timeout being
+  // the budget for the whole batch rather than for each message. The checks above are
+  // made once for the batch, before anything is sent; entries of size 0 are skipped
+
+  struct BatchEntry
+  {
+    const void* message{ nullptr };
+    size_type size{ 0 };
+    std::string_view metadata{};
+  };
+
+  void send_batch(const std::vector<BatchEntry>& messages, const duration_type& timeout);
+
+  // poll_handle() says what to wait on for this Sender to be able to send. Transports
+  // which can't be polled return the default, invalid, handle
+  virtual PollHandle poll_handle() noexcept { return PollHandle(); }
+
+  // statistics() reports whatever counters the transport keeps, as a JSON object whose
+  // keys depend on the implementation. It may be called while another thread is sending
+  virtual nlohmann::json statistics() const { return nlohmann::json::object(); }
+
   Sender(const Sender&) = delete;
   Sender& operator=(const Sender&) = delete;
 
@@ -99,6 +170,18 @@ public:
 
 protected:
   virtual void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) = 0;
+
+  // Default implementation turns the timeout thrown by send_ into a status
+  virtual Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata)
+  {
+    try {
+      send_(message, N, timeout, metadata);
+    } catch (SendTimeoutExpired const&) {
+      return Status::Timeout;
+    }
+    return Status::Ok;
+  }
+
   virtual void send_multipart_(const void** message_parts,
                                const std::vector<size_type>& message_sizes,
                                const duration_type& timeout,
@@ -108,6 +191,69 @@ protected:
       send_(message_parts[i], message_sizes[i], timeout, metadata);
     }
   }
+
+  // Default implementation calls send_ for each message with what remains of the timeout
+  virtual void send_batch_(const std::vector<BatchEntry>& messages, const duration_type& timeout)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& entry : messages) {
+      if (entry.size == 0) {
+        continue;
+      }
+      auto remaining = timeout;
+      if (timeout != block) {
+        auto elapsed = std::chrono::duration_cast<duration_type>(std::chrono::steady_clock::now() - start);
+        remaining = std::max(noblock, timeout - elapsed);
+      }
+      send_(entry.message, entry.size, remaining, std::string(entry.metadata));
+    }
+  }
+
+  // Default implementation copies the message via send_, then releases it
+  virtual void send_buffer_(MessageBuffer message, const duration_type& timeout, std::string const& metadata)
+  {
+    send_(message.data(), message.size(), timeout, metadata);
+  }
+
+  // Default implementation sends the message synchronously
+  virtual std::future<Status> send_async_(MessageBuffer message,
+                                          const duration_type& timeout,
+                                          std::string const& metadata)
+  {
+    std::promise<Status> promise;
+    try {
+      send_buffer_(std::move(message), timeout, metadata);
+      promise.set_value(Status::Ok);
+    } catch (SendTimeoutExpired const&) {
+      promise.set_value(Status::Timeout);
+    } catch (SendFailed const&) {
+      promise.set_value(Status::Error);
+    }
+    return promise.get_future();
+  }
+
+  virtual void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                                      const duration_type& timeout,
+                                      std::string const& metadata)
+  {
+    for (auto& part : message_parts) {
+      send_buffer_(std::move(part), timeout, metadata);
+    }
+  }
+
+  // For implementations whose throwing calls are built on their try_ counterparts:
+  // throws the exception matching a status other than Ok
+  static void check_status(Status status, const duration_type& timeout)
+  {
+    switch (status) {
+      case Status::Ok:
+        return;
+      case Status::Timeout:
+        throw SendTimeoutExpired(ERS_HERE, timeout.count());
+      default:
+        throw SendFailed(ERS_HERE, to_string(status));
+    }
+  }
 };
 
 inline void
@@ -128,6 +274,24 @@ Sender::send(const void* message, size_type message_size, const duration_type& t
   send_(message, message_size, timeout, metadata);
 }
 
+inline Status
+Sender::try_send(const void* message, size_type message_size, const duration_type& timeout, std::string const& metadata)
+{
+  if (message_size == 0) {
+    return Status::Ok;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  if (!message) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+
+  return try_send_(message, message_size, timeout, metadata);
+}
+
 inline void
 Sender::send_multipart(const void** message_parts,
                        const std::vector<size_type>& message_sizes,
@@ -149,6 +313,86 @@ Sender::send_multipart(const void** message_parts,
   send_multipart_(message_parts, message_sizes, timeout, metadata);
 }
 
+inline void
+Sender::send_batch(const std::vector<BatchEntry>& messages, const duration_type& timeout)
+{
+  if (messages.empty()) {
+    return;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  for (auto const& entry : messages) {
+    if (!entry.message && entry.size != 0) {
+      throw NullPointerPassedToSend(ERS_HERE);
+    }
+  }
+
+  send_batch_(messages, timeout);
+}
+
+inline void
+Sender::send(MessageBuffer message, const duration_type& timeout, std::string const& metadata)
+{
+  if (message.empty()) {
+    return;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  if (!message.data()) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+
+  send_buffer_(std::move(message), timeout, metadata);
+}
+
+inline void
+Sender::send_multipart(std::vector<MessageBuffer> message_parts,
+                       const duration_type& timeout,
+                       std::string const& metadata)
+{
+  if (message_parts.empty()) {
+    return;
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  for (auto const& part : message_parts) {
+    if (!part.data() && !part.empty()) {
+      throw NullPointerPassedToSend(ERS_HERE);
+    }
+  }
+
+  send_buffer_multipart_(std::move(message_parts), timeout, metadata);
+}
+
+inline std::future<Status>
+Sender::send_async(MessageBuffer message, const duration_type& timeout, std::string const& metadata)
+{
+  if (message.empty()) {
+    std::promise<Status> promise;
+    promise.set_value(Status::Ok);
+    return promise.get_future();
+  }
+
+  if (!can_send()) {
+    throw KnownStateForbidsSend(ERS_HERE);
+  }
+
+  if (!message.data()) {
+    throw NullPointerPassedToSend(ERS_HERE);
+  }
+
+  return send_async_(std::move(message), timeout, metadata);
+}
+
 std::shared_ptr<Sender>
 makeIPMSender(std::string const& plugin_name)
 {
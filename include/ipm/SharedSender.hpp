@@ -0,0 +1,238 @@
+/**
+ * @file SharedSender.hpp SharedSender Class Interface
+ *
+ * SharedSender lets any number of threads send through one Sender, such
+ * as a ZmqSender whose socket may only be used by one thread. Producers
+ * push their messages onto a lock-free MPSCQueue and return, and a single
+ * owner thread drains the queue into the wrapped Sender, passing runs of
+ * queued messages to its send_batch() together. Producers therefore never
+ * wait on each other, or on the transport, unless the queue is full.
+ *
+ * A SharedSender can wrap an existing Sender, or be made with
+ * makeIPMSender("SharedSender"), in which case connect_for_sends() makes
+ * the Sender named by "shared_plugin" in the connection info and connects
+ * it with the same info. "queue_capacity" (1024 messages by default) and
+ * "batch_size" (64 messages by default) can also be set there, as can
+ * "shared_thread_cpus", the CPUs to pin the owner thread to. Producers may
+ * already be pushing once it is connected, so it can't be connected again.
+ *
+ * The queue and owner thread are a SendQueue, as in ZmqSender's async mode.
+ * The timeout of a send covers the wait for room in the queue, as well as
+ * the send by the owner thread. Only send_async() reports what became of a
+ * message; otherwise failures are reported through ERS
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_SHAREDSENDER_HPP_
+#define IPM_INCLUDE_IPM_SHAREDSENDER_HPP_
+
+#include "ipm/SendQueue.hpp"
+#include "ipm/Sender.hpp"
+#include "ipm/ThreadPlacement.hpp"
+
+#include "ers/Issue.h"
+#include "ers/ers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, SharedSenderAlreadyConnected, "SharedSender::connect_for_sends may only be called once", )
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class SharedSender : public Sender
+{
+public:
+  using clock_type = SendQueue::clock_type;
+
+  static constexpr size_t default_queue_capacity = 1024;
+  static constexpr size_t default_batch_size = 64;
+
+  // Used by makeIPMSender("SharedSender"), with the wrapped Sender made by connect_for_sends
+  SharedSender() = default;
+
+  // The wrapped Sender must only be used through the SharedSender from now on
+  explicit SharedSender(std::shared_ptr<Sender> sender)
+    : sender_(std::move(sender))
+  {}
+
+  // Whatever is still queued gets a single attempt at being sent
+  ~SharedSender() override { queue_.stop(); }
+
+  bool can_send() const noexcept override { return queue_.running() && sender_ && sender_->can_send(); }
+
+  // Connects the wrapped Sender, making it first if need be, then starts the owner thread
+  // -Throws SharedSenderAlreadyConnected if called again
+  void connect_for_sends(const nlohmann::json& connection_info) override;
+
+protected:
+  void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    auto pending = SendQueue::make_pending(timeout, metadata);
+    pending.parts.push_back(SendQueue::copy(message, N));
+    return queue_.push(std::move(pending));
+  }
+
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& metadata) override
+  {
+    auto pending = SendQueue::make_pending(timeout, metadata);
+    for (size_t i = 0; i < message_sizes.size(); ++i) {
+      pending.parts.push_back(SendQueue::copy(message_parts[i], message_sizes[i]));
+    }
+    pending.multipart = true;
+    check_status(queue_.push(std::move(pending)), timeout);
+  }
+
+  // The messages are queued one by one against the batch's deadline, so the owner
+  // thread is free to send them in its own batches
+  void send_batch_(const std::vector<BatchEntry>& messages, const duration_type& timeout) override
+  {
+    auto deadline = SendQueue::deadline_for(timeout);
+    for (auto const& entry : messages) {
+      if (entry.size > 0) {
+        SendQueue::PendingSend pending;
+        pending.parts.push_back(SendQueue::copy(entry.message, entry.size));
+        pending.topic = std::string(entry.metadata);
+        pending.deadline = deadline;
+        check_status(queue_.push(std::move(pending)), timeout);
+      }
+    }
+  }
+
+  void send_buffer_(MessageBuffer message, const duration_type& timeout, std::string const& metadata) override
+  {
+    auto pending = SendQueue::make_pending(timeout, metadata);
+    pending.parts.push_back(std::move(message));
+    check_status(queue_.push(std::move(pending)), timeout);
+  }
+
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& metadata) override
+  {
+    auto pending = SendQueue::make_pending(timeout, metadata);
+    pending.parts = std::move(message_parts);
+    pending.multipart = true;
+    check_status(queue_.push(std::move(pending)), timeout);
+  }
+
+  std::future<Status> send_async_(MessageBuffer message,
+                                  const duration_type& timeout,
+                                  std::string const& metadata) override
+  {
+    auto pending = SendQueue::make_pending(timeout, metadata);
+    pending.parts.push_back(std::move(message));
+    return queue_.push_async(std::move(pending));
+  }
+
+private:
+  void send_pending(std::vector<SendQueue::PendingSend>& batch);
+  Status send_one(SendQueue::PendingSend& pending);
+
+  // Once stopping, whatever is still queued gets a single attempt
+  duration_type timeout_for(clock_type::time_point deadline) const
+  {
+    return queue_.stopping() ? noblock : SendQueue::timeout_for(deadline);
+  }
+
+  std::shared_ptr<Sender> sender_;
+  SendQueue queue_;
+};
+
+inline void
+SharedSender::connect_for_sends(const nlohmann::json& connection_info)
+{
+  if (queue_.running()) {
+    throw SharedSenderAlreadyConnected(ERS_HERE);
+  }
+  if (!sender_) {
+    sender_ = makeIPMSender(connection_info.value<std::string>("shared_plugin", "ZmqSender"));
+  }
+  sender_->connect_for_sends(connection_info);
+
+  queue_.start(connection_info.value<size_t>("queue_capacity", default_queue_capacity),
+               connection_info.value<size_t>("batch_size", default_batch_size),
+               placement::cpus_for(connection_info, "shared_thread_cpus"),
+               [this](std::vector<SendQueue::PendingSend>& batch) { send_pending(batch); });
+}
+
+// Runs of plain single-part messages go to the wrapped Sender's send_batch() together,
+// with the earliest of their deadlines. Multipart messages, and those whose outcome
+// send_async() is waiting for, are sent on their own
+inline void
+SharedSender::send_pending(std::vector<SendQueue::PendingSend>& batch)
+{
+  std::vector<BatchEntry> entries;
+  auto deadline = clock_type::time_point::max();
+  auto flush = [&] {
+    if (entries.empty()) {
+      return;
+    }
+    try {
+      sender_->send_batch(entries, timeout_for(deadline));
+    } catch (SendTimeoutExpired const&) {
+      ers::warning(SendFailed(ERS_HERE, to_string(Status::Timeout)));
+    } catch (ers::Issue const& issue) {
+      ers::warning(SendFailed(ERS_HERE, to_string(Status::Error), issue));
+    }
+    entries.clear();
+    deadline = clock_type::time_point::max();
+  };
+
+  for (auto& pending : batch) {
+    if (pending.multipart || pending.promise) {
+      flush();
+      auto status = send_one(pending);
+      if (pending.promise) {
+        pending.promise->set_value(status);
+      } else if (status != Status::Ok) {
+        ers::warning(SendFailed(ERS_HERE, to_string(status)));
+      }
+      continue;
+    }
+    auto const& part = pending.parts.front();
+    entries.push_back({ part.data(), static_cast<size_type>(part.size()), pending.topic });
+    deadline = std::min(deadline, pending.deadline);
+  }
+  flush();
+}
+
+inline Status
+SharedSender::send_one(SendQueue::PendingSend& pending)
+{
+  auto timeout = timeout_for(pending.deadline);
+  try {
+    if (pending.multipart) {
+      sender_->send_multipart(std::move(pending.parts), timeout, pending.topic);
+    } else {
+      sender_->send(std::move(pending.parts.front()), timeout, pending.topic);
+    }
+  } catch (SendTimeoutExpired const&) {
+    return Status::Timeout;
+  } catch (ers::Issue const&) {
+    return Status::Error;
+  }
+  return Status::Ok;
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_SHAREDSENDER_HPP_
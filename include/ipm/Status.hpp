@@ -0,0 +1,60 @@
+/**
+ * @file Status.hpp Status and Result types returned by IPM's non-throwing calls
+ *
+ * The try_ variants of Sender::send and Receiver::receive report the
+ * outcome of the operation as a Status instead of throwing, so that
+ * e.g. a timeout in a tight polling loop costs no more than a branch
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_STATUS_HPP_
+#define IPM_INCLUDE_IPM_STATUS_HPP_
+
+namespace dunedaq::ipm {
+
+enum class Status
+{
+  Ok,
+  Timeout,     // Nothing could be sent or received within the timeout
+  Interrupted, // The call was interrupted by a signal
+  Error,       // The transport failed; the call throws when not using the try_ variant
+};
+
+inline const char*
+to_string(Status status) noexcept
+{
+  switch (status) {
+    case Status::Ok:
+      return "Ok";
+    case Status::Timeout:
+      return "Timeout";
+    case Status::Interrupted:
+      return "Interrupted";
+    case Status::Error:
+      return "Error";
+  }
+  return "Unknown";
+}
+
+// The value is only meaningful if the status is Ok
+template<typename T>
+struct Result
+{
+  Status status{ Status::Error };
+  T value{};
+
+  bool ok() const noexcept { return status == Status::Ok; }
+  explicit operator bool() const noexcept { return ok(); }
+
+  T& operator*() noexcept { return value; }
+  const T& operator*() const noexcept { return value; }
+  T* operator->() noexcept { return &value; }
+  const T* operator->() const noexcept { return &value; }
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_STATUS_HPP_
@@ -0,0 +1,121 @@
+/**
+ * @file ThreadPlacement.hpp Placement of IPM's threads and buffers on CPUs and NUMA nodes
+ *
+ * Each thread which IPM starts can be pinned to a set of CPUs given as a
+ * list in the JSON it is configured from, e.g. "io_thread_cpus": [2, 3].
+ * An empty or missing list leaves the thread where the scheduler puts it.
+ *
+ * On a machine with more than one NUMA node, memory which a pinned thread
+ * works on is best kept on that thread's node. Linux puts a page on the
+ * node of the thread which first touches it, so buffers which a thread
+ * allocates and fills itself are already local. move_to_local_node() is for
+ * buffers made on another thread, such as those set up by
+ * connect_for_receives() and then read into by a Receiver's I/O thread.
+ * It calls mbind directly, so libnuma isn't needed
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_THREADPLACEMENT_HPP_
+#define IPM_INCLUDE_IPM_THREADPLACEMENT_HPP_
+
+#include "ers/Issue.h"
+#include "ers/ers.h"
+#include "nlohmann/json.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm,
+                  ThreadPinningFailed,
+                  "Pinning a thread to CPUs " << cpus << " failed: " << error,
+                  ((std::string)cpus)((std::string)error)) // NOLINT
+} // namespace dunedaq
+
+namespace dunedaq::ipm::placement {
+
+// The list of CPUs under "key" in the configuration, empty if there isn't one
+inline std::vector<int>
+cpus_for(const nlohmann::json& config, std::string const& key)
+{
+  return config.value<std::vector<int>>(key, std::vector<int>());
+}
+
+// Pins the calling thread to the CPUs, doing nothing if there are none. The thread works
+// wherever it runs, so a failure, e.g. from a CPU outside the process's cpuset, is only
+// warned about, and false returned
+inline bool
+pin_this_thread(std::vector<int> const& cpus)
+{
+  if (cpus.empty()) {
+    return true;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::ostringstream names;
+  for (auto cpu : cpus) {
+    names << (names.tellp() > 0 ? "," : "") << cpu;
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (rc != 0) {
+    ers::warning(ThreadPinningFailed(ERS_HERE, names.str(), std::strerror(rc)));
+    return false;
+  }
+  return true;
+}
+
+// The NUMA node of the CPU the calling thread is running on, or -1 if it can't be found
+inline int
+current_node()
+{
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<int>(node);
+}
+
+// Moves the whole pages within [data, data + size) to the calling thread's NUMA node,
+// and has any not yet touched put there. Returns false if the kernel wouldn't, e.g.
+// without NUMA support, or for pages it can't migrate; the memory is usable either way
+inline bool
+move_to_local_node(void* data, size_t size)
+{
+  // From <numaif.h>
+  constexpr int mpol_preferred = 1;
+  constexpr unsigned mpol_mf_move = 1 << 1;
+
+  auto node = current_node();
+  if (node < 0 || node >= 64) {
+    return false;
+  }
+  auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto begin = (reinterpret_cast<uintptr_t>(data) + page_size - 1) & ~(page_size - 1); // NOLINT
+  auto end = (reinterpret_cast<uintptr_t>(data) + size) & ~(page_size - 1);             // NOLINT
+  if (end <= begin) {
+    return true;
+  }
+
+  uint64_t nodes = uint64_t{ 1 } << node;
+  return syscall(SYS_mbind, begin, end - begin, mpol_preferred, &nodes, sizeof(nodes) * 8 + 1, mpol_mf_move) == 0;
+}
+
+} // namespace dunedaq::ipm::placement
+
+#endif // IPM_INCLUDE_IPM_THREADPLACEMENT_HPP_
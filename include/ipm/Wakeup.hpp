@@ -0,0 +1,77 @@
+/**
+ * @file Wakeup.hpp Wakeup Class Interface
+ *
+ * Wakeup lets threads sleep until another thread has given them something
+ * to do, such as the consumer of a lock-free queue waiting for producers to
+ * push, or producers waiting for the consumer to make room. A waiting
+ * thread says that it is about to sleep, and the others only take the
+ * mutex to wake it when one has, so a thread which finds nobody waiting
+ * pays for a fence and a load rather than a lock. Each side fences between
+ * its store and its load, so either the waiting thread sees what the other
+ * did or the other sees that it is waiting: no wakeup is lost, and the
+ * waiting thread needs no polling timeout to make up for one
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_INCLUDE_IPM_WAKEUP_HPP_
+#define IPM_INCLUDE_IPM_WAKEUP_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace dunedaq::ipm {
+
+class Wakeup
+{
+public:
+  Wakeup() = default;
+
+  // From any thread, once it has made the waiting threads' condition true
+  void notify()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed) != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv_.notify_all();
+    }
+  }
+
+  // From any number of waiting threads: sleeps until "ready" returns true or the deadline
+  // passes, and returns what "ready" last returned. A deadline of time_point::max() never
+  // passes
+  template<typename Clock, typename Duration, typename Predicate>
+  bool wait_until(std::chrono::time_point<Clock, Duration> deadline, Predicate ready)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool result = true;
+    if (deadline == std::chrono::time_point<Clock, Duration>::max()) {
+      cv_.wait(lock, ready);
+    } else {
+      result = cv_.wait_until(lock, deadline, ready);
+    }
+    waiting_.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  Wakeup(const Wakeup&) = delete;
+  Wakeup& operator=(const Wakeup&) = delete;
+
+  Wakeup(Wakeup&&) = delete;
+  Wakeup& operator=(Wakeup&&) = delete;
+
+private:
+  std::atomic<unsigned> waiting_{ 0 };
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_INCLUDE_IPM_WAKEUP_HPP_
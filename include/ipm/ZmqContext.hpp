@@ -5,30 +5,209 @@
  *
  * @file ZmqContext.hpp ZmqContext Singleton class for hosting 0MQ context
  *
+ * The context is created by the first call to instance(), which the ZMQ
+ * plugins make when they are constructed. Until then, configure() can set
+ * its options from JSON:
+ *
+ * - "io_threads": the number of I/O threads (1 by default)
+ * - "thread_affinity": the CPUs the I/O threads may run on, e.g. [2, 3]
+ * - "thread_priority" and "thread_sched_policy": the I/O threads' scheduling
+ * - "max_sockets": the most sockets the context will open
+ *
+ * Each can also be set through the environment, as IPM_ZMQ_IO_THREADS,
+ * IPM_ZMQ_THREAD_AFFINITY (a comma-separated list of CPUs),
+ * IPM_ZMQ_THREAD_PRIORITY, IPM_ZMQ_THREAD_SCHED_POLICY and
+ * IPM_ZMQ_MAX_SOCKETS, which override the JSON so that a run can be tuned
+ * without changing its configuration. DAQModules make their sockets in
+ * init(), so they pass the "zmq_context" object of their init data to
+ * configure_from_init() first. With more than one I/O thread, the
+ * ZMQ plugins' "io_thread_affinity" connection option says which of them
+ * a socket may use
+ *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
  * received with this code.
  */
 
+#include "ers/Issue.h"
+#include "nlohmann/json.hpp"
+
 #include <zmq.hpp>
 
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm, ZmqContextAlreadyCreated, "ZmqContext::configure was called after the context was created", )
+ERS_DECLARE_ISSUE(ipm,
+                  ZmqContextOptionFailed,
+                  "Setting ZMQ context option " << option << " to " << value << " failed: " << error,
+                  ((std::string)option)((int)value)((std::string)error)) // NOLINT
+ERS_DECLARE_ISSUE(ipm,
+                  ZmqContextBadEnvironment,
+                  "The environment variable " << variable << " is set to \"" << value << "\", which isn't "
+                                              << expected,
+                  ((std::string)variable)((std::string)value)((std::string)expected))
+} // namespace dunedaq
+
 namespace dunedaq::ipm {
 class ZmqContext
 {
 public:
+  // Options left at -1 keep ZMQ's defaults
+  struct Config
+  {
+    int io_threads{ -1 };
+    std::vector<int> thread_affinity{};
+    int thread_priority{ -1 };
+    int thread_sched_policy{ -1 };
+    int max_sockets{ -1 };
+  };
+
   static ZmqContext& instance()
   {
     static ZmqContext ctx;
     return ctx;
   }
 
+  // -Throws ZmqContextAlreadyCreated if instance() has already been called
+  static void configure(const nlohmann::json& config)
+  {
+    std::lock_guard<std::mutex> lock(config_mutex());
+    if (created()) {
+      throw ZmqContextAlreadyCreated(ERS_HERE);
+    }
+    auto& pending = pending_config();
+    pending.io_threads = config.value<int>("io_threads", pending.io_threads);
+    pending.thread_affinity = config.value<std::vector<int>>("thread_affinity", pending.thread_affinity);
+    pending.thread_priority = config.value<int>("thread_priority", pending.thread_priority);
+    pending.thread_sched_policy = config.value<int>("thread_sched_policy", pending.thread_sched_policy);
+    pending.max_sockets = config.value<int>("max_sockets", pending.max_sockets);
+  }
+
+  // Configures the context from the "zmq_context" object in a DAQModule's init data, if
+  // there is one; only the first module to be initialised in a process should have it
+  // -Throws ZmqContextAlreadyCreated if a ZMQ plugin has already been created
+  static void configure_from_init(const nlohmann::json& init_data)
+  {
+    if (init_data.contains("zmq_context")) {
+      configure(init_data.at("zmq_context"));
+    }
+  }
+
   zmq::context_t& GetContext() { return context_; }
+
+  // Restricts the socket to the I/O threads set in the bitmask "io_thread_affinity" in
+  // the connection info, for instance so that high-rate sockets get a thread each. This
+  // has to be done before the socket is bound or connected; 0, the default, means any
+  static void set_io_thread_affinity(zmq::socket_t& socket, const nlohmann::json& connection_info)
+  {
+    auto affinity = connection_info.value<uint64_t>("io_thread_affinity", 0);
+    if (affinity != 0) {
+      socket.setsockopt<uint64_t>(ZMQ_AFFINITY, affinity);
+    }
+  }
+
   private:
-  ZmqContext() {}
+  // The options have to be set before any socket is created
+  // -Throws ZmqContextBadEnvironment if an IPM_ZMQ_ variable can't be read, in which
+  //  case the next call to instance() tries again
+  // -Throws ZmqContextOptionFailed if ZMQ rejects one of them
+  ZmqContext()
+  {
+    std::lock_guard<std::mutex> lock(config_mutex());
+    auto config = pending_config();
+    read_environment(config);
+    created() = true;
+
+    set_option("ZMQ_IO_THREADS", ZMQ_IO_THREADS, config.io_threads);
+    set_option("ZMQ_THREAD_PRIORITY", ZMQ_THREAD_PRIORITY, config.thread_priority);
+    set_option("ZMQ_THREAD_SCHED_POLICY", ZMQ_THREAD_SCHED_POLICY, config.thread_sched_policy);
+    set_option("ZMQ_MAX_SOCKETS", ZMQ_MAX_SOCKETS, config.max_sockets);
+    for (auto cpu : config.thread_affinity) {
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+      set_option("ZMQ_THREAD_AFFINITY_CPU_ADD", ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+#else
+      throw ZmqContextOptionFailed(ERS_HERE, "ZMQ_THREAD_AFFINITY_CPU_ADD", cpu, "not supported by this libzmq");
+#endif
+    }
+  }
+
     ~ZmqContext()
     {
       context_.close();
     }
+
+    static void read_environment(Config& config)
+    {
+      auto read_int = [](const char* name, int& value) {
+        if (auto setting = std::getenv(name)) {
+          value = parse_int(name, setting, setting, "an integer");
+        }
+      };
+      read_int("IPM_ZMQ_IO_THREADS", config.io_threads);
+      read_int("IPM_ZMQ_THREAD_PRIORITY", config.thread_priority);
+      read_int("IPM_ZMQ_THREAD_SCHED_POLICY", config.thread_sched_policy);
+      read_int("IPM_ZMQ_MAX_SOCKETS", config.max_sockets);
+      if (auto setting = std::getenv("IPM_ZMQ_THREAD_AFFINITY")) {
+        config.thread_affinity.clear();
+        std::istringstream cpus(setting);
+        std::string cpu;
+        while (std::getline(cpus, cpu, ',')) {
+          config.thread_affinity.push_back(
+            parse_int("IPM_ZMQ_THREAD_AFFINITY", setting, cpu, "a comma-separated list of CPUs"));
+        }
+      }
+    }
+
+    // The whole of "text", which is part of "setting", has to be an integer
+    static int parse_int(const char* name, std::string const& setting, std::string const& text, const char* expected)
+    {
+      size_t end = 0;
+      int value = 0;
+      try {
+        value = std::stoi(text, &end);
+      } catch (std::invalid_argument const&) {
+        throw ZmqContextBadEnvironment(ERS_HERE, name, setting, expected);
+      } catch (std::out_of_range const&) {
+        throw ZmqContextBadEnvironment(ERS_HERE, name, setting, expected);
+      }
+      if (end != text.size()) {
+        throw ZmqContextBadEnvironment(ERS_HERE, name, setting, expected);
+      }
+      return value;
+    }
+
+    void set_option(const char* name, int option, int value)
+    {
+      if (value >= 0 && zmq_ctx_set(static_cast<void*>(context_), option, value) != 0) {
+        throw ZmqContextOptionFailed(ERS_HERE, name, value, zmq_strerror(zmq_errno()));
+      }
+    }
+
+    static Config& pending_config()
+    {
+      static Config config;
+      return config;
+    }
+
+    static bool& created()
+    {
+      static bool created = false;
+      return created;
+    }
+
+    static std::mutex& config_mutex()
+    {
+      static std::mutex mutex;
+      return mutex;
+    }
+
     zmq::context_t context_;
 
     ZmqContext(ZmqContext const&) = delete;
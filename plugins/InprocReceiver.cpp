@@ -0,0 +1,104 @@
+/**
+ *
+ * @file InprocReceiver.cpp InprocReceiver messaging class definitions
+ *
+ * InprocReceiver takes the messages InprocSenders in the same process
+ * queue to its connection string (see InprocRegistry.hpp). receive_buffer
+ * hands out the Sender's own MessageBuffers, so nothing is copied
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "InprocReceiver"
+
+#include "ipm/InprocRegistry.hpp"
+#include "ipm/Receiver.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+class InprocReceiver : public Receiver
+{
+public:
+  static constexpr size_t default_queue_capacity = 1024;
+
+  ~InprocReceiver() override
+  {
+    if (channel_) {
+      channel_->release_receiver();
+    }
+  }
+
+  bool can_receive() const noexcept override { return channel_ != nullptr; }
+  // -Throws InprocReceiverAlreadyConnected if another Receiver is using the connection string
+  void connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    std::string connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+    auto channel = InprocRegistry::instance().channel(
+      connection_string, connection_info.value<size_t>("queue_capacity", default_queue_capacity));
+    if (!channel->claim_receiver()) {
+      throw InprocReceiverAlreadyConnected(ERS_HERE, connection_string);
+    }
+    if (channel_) {
+      channel_->release_receiver();
+    }
+    channel_ = std::move(channel);
+  }
+
+protected:
+  Receiver::Response receive_(const duration_type& timeout) override
+  {
+    auto result = try_receive_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::Response> try_receive_(const duration_type& timeout) override
+  {
+    InprocChannel::Message message;
+    Result<Receiver::Response> result;
+    result.status = channel_->pop(message, InprocChannel::deadline_for(timeout));
+    if (result.status == Status::Ok) {
+      result->data.assign(message.data.begin(), message.data.end());
+      result->metadata = std::move(message.metadata);
+    }
+    return result;
+  }
+
+  Receiver::BufferResponse receive_buffer_(const duration_type& timeout) override
+  {
+    auto result = try_receive_buffer_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    InprocChannel::Message message;
+    Result<Receiver::BufferResponse> result;
+    result.status = channel_->pop(message, InprocChannel::deadline_for(timeout));
+    if (result.status == Status::Ok) {
+      result->data = std::move(message.data);
+      if (!message.metadata.empty()) {
+        result->metadata = MessageBuffer::adopt(std::move(message.metadata));
+      }
+    }
+    return result;
+  }
+
+private:
+  std::shared_ptr<InprocChannel> channel_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::InprocReceiver)
@@ -0,0 +1,102 @@
+/**
+ *
+ * @file InprocSender.cpp InprocSender messaging class definitions
+ *
+ * InprocSender hands messages to the InprocReceiver in the same process
+ * with the same connection string (see InprocRegistry.hpp). A MessageBuffer
+ * passed to send is moved to the Receiver as it is; a raw buffer is copied
+ * once, as the caller keeps it
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "InprocSender"
+
+#include "ipm/InprocRegistry.hpp"
+#include "ipm/Sender.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class InprocSender : public Sender
+{
+public:
+  static constexpr size_t default_queue_capacity = 1024;
+
+  bool can_send() const noexcept override { return channel_ != nullptr; }
+  void connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    std::string connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+    channel_ = InprocRegistry::instance().channel(
+      connection_string, connection_info.value<size_t>("queue_capacity", default_queue_capacity));
+  }
+
+protected:
+  void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    auto bytes = static_cast<const char*>(message);
+    return push(MessageBuffer::adopt(std::vector<char>(bytes, bytes + N)), timeout, metadata);
+  }
+
+  void send_buffer_(MessageBuffer message, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(push(std::move(message), timeout, metadata), timeout);
+  }
+
+  // The parts are gathered into a single message
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& metadata) override
+  {
+    std::vector<char> gathered;
+    for (size_t i = 0; i < message_sizes.size(); ++i) {
+      auto bytes = static_cast<const char*>(message_parts[i]);
+      gathered.insert(gathered.end(), bytes, bytes + message_sizes[i]);
+    }
+    check_status(push(MessageBuffer::adopt(std::move(gathered)), timeout, metadata), timeout);
+  }
+
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& metadata) override
+  {
+    if (message_parts.size() == 1) {
+      send_buffer_(std::move(message_parts.front()), timeout, metadata);
+      return;
+    }
+    std::vector<char> gathered;
+    for (auto const& part : message_parts) {
+      gathered.insert(gathered.end(), part.begin(), part.end());
+    }
+    check_status(push(MessageBuffer::adopt(std::move(gathered)), timeout, metadata), timeout);
+  }
+
+private:
+  Status push(MessageBuffer&& data, const duration_type& timeout, std::string const& metadata)
+  {
+    return channel_->push(InprocChannel::Message{ std::move(data), metadata }, InprocChannel::deadline_for(timeout));
+  }
+
+  std::shared_ptr<InprocChannel> channel_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::InprocSender)
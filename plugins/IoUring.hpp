@@ -0,0 +1,533 @@
+/**
+ *
+ * @file IoUring.hpp Minimal io_uring wrapper used by the Uring transport plugins
+ *
+ * IoUring sets up a submission and completion queue pair with the raw
+ * io_uring system calls, so nothing beyond the kernel headers is needed.
+ * Its one operation, submit_and_wait(), submits a socket operation together
+ * with a linked timeout for the deadline and waits for both completions.
+ * This replaces the try/poll/retry sequence of calls which the plain
+ * socket path makes while waiting.
+ *
+ * There is one ring per process, which every Uring Sender and Receiver
+ * shares, whatever thread they are used from. An operation's entries are
+ * queued under the ring's mutex, and whichever thread next enters the
+ * kernel submits everything queued by then. One thread at a time waits in
+ * io_uring_enter for completions, and hands out all those which have
+ * arrived to the threads waiting for them, taking one for itself; when its
+ * own operation completes, another waiting thread takes over. So with many
+ * connections busy, a single system call submits or reaps the operations
+ * of several of them.
+ *
+ * Buffers registered with the ring can be read into with
+ * IORING_OP_READ_FIXED, and written from with IORING_OP_WRITE_FIXED, which
+ * saves mapping their pages on every call. They share the ring's sparse
+ * table of max_fixed_buffers entries, so registering needs Linux 5.19;
+ * with an older kernel, or a full table, the buffer just isn't registered.
+ * A write can't be given MSG_NOSIGNAL, so threads which use the ring have
+ * SIGPIPE blocked, and a write to a closed socket fails with EPIPE instead.
+ *
+ * If io_uring_enter fails to submit, the entries the kernel hasn't taken
+ * are taken back, their operations fail, and the ring takes no new ones.
+ * If waiting for completions fails, the ring is torn down, which has the
+ * kernel cancel whatever is left, and every operation still in it fails.
+ * Either way the ring is unusable after, and shared() makes a new one
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_IOURING_HPP_
+#define IPM_PLUGINS_IOURING_HPP_
+
+#include "ipm/Status.hpp"
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dunedaq::ipm {
+
+class IoUring
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  static constexpr unsigned default_entries = 256;
+  static constexpr unsigned max_fixed_buffers = 64;
+
+  // The process's ring, made if there isn't a usable one. Returns nullptr if the kernel
+  // doesn't support io_uring, or it has been disabled
+  static std::shared_ptr<IoUring> shared()
+  {
+    static std::mutex mutex;
+    static std::weak_ptr<IoUring> existing;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto ring = existing.lock();
+    if (!ring || !ring->usable()) {
+      ring = create(default_entries);
+      existing = ring;
+    }
+    return ring;
+  }
+
+  // A ring of its own, for tests; returns nullptr as shared() does
+  static std::shared_ptr<IoUring> create(unsigned entries)
+  {
+    std::shared_ptr<IoUring> ring(new IoUring());
+    return ring->setup(entries) ? std::move(ring) : nullptr;
+  }
+
+  ~IoUring() { tear_down(); }
+
+  // False once the ring has failed, after which every operation fails. May be called from
+  // any thread
+  bool usable() const noexcept { return !broken_.load(std::memory_order_acquire); }
+
+  // Registers "size" bytes at "data" as a fixed buffer, returning its index for the
+  // operations which use it, or -1 if it couldn't be registered
+  int register_buffer(void* data, size_t size);
+
+  // Frees the index for another buffer; operations using it must have completed
+  void unregister_buffer(int index);
+
+  // Queues the operation "prepare" fills in, with a timeout at the deadline, and waits
+  // for it to complete. "result" is the operation's result, as the equivalent system
+  // call would return it, or -errno. Returns Status::Timeout if the deadline passed
+  // before the operation could start, Status::Error if io_uring_enter failed, in which
+  // case the operation may or may not have been carried out, and Status::Ok otherwise
+  template<typename Prepare>
+  Status submit_and_wait(Prepare prepare, clock_type::time_point deadline, int& result);
+
+  // How many operations have completed through the ring, and how many io_uring_enter
+  // calls they took between them. May be read from any thread
+  uint64_t operations() const noexcept { return operations_.load(std::memory_order_relaxed); }
+  uint64_t enter_calls() const noexcept { return enter_calls_.load(std::memory_order_relaxed); }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  IoUring(IoUring&&) = delete;
+  IoUring& operator=(IoUring&&) = delete;
+
+private:
+  // An operation waiting for its entries' completions, which is where their user_data
+  // points, with the entry's kind in the low bits
+  struct alignas(8) Operation
+  {
+    int result{ 0 };
+    unsigned outstanding{ 0 };
+    bool cancelled{ false }; // By its linked timeout
+    bool failed{ false };    // By the ring
+    __kernel_timespec timeout{}; // Read by the kernel until the timeout completes
+  };
+
+  static constexpr uint64_t operation_tag = 0;
+  static constexpr uint64_t timeout_tag = 1;
+  static constexpr uint64_t tag_mask = 7;
+
+  IoUring() = default;
+
+  bool setup(unsigned entries);
+
+  long enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+  {
+    block_sigpipe();
+    enter_calls_.fetch_add(1, std::memory_order_relaxed);
+    return syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+  }
+
+  // A write can't be given MSG_NOSIGNAL, so if the peer has gone, the kernel raises SIGPIPE
+  // in the thread which submitted it, or finished it off. Each thread using the ring has
+  // it blocked from then on, leaving the write to fail with EPIPE as a send would
+  static void block_sigpipe()
+  {
+    thread_local bool blocked = false;
+    if (!blocked) {
+      sigset_t pipe;
+      sigemptyset(&pipe);
+      sigaddset(&pipe, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+      blocked = true;
+    }
+  }
+
+  // The entries queued but not yet taken by the kernel
+  unsigned unsubmitted() const
+  {
+    return sq_tail_->load(std::memory_order_relaxed) - sq_head_->load(std::memory_order_acquire);
+  }
+
+  // With the mutex held: the next free entry, which isn't the kernel's until publish()
+  io_uring_sqe* next_sqe(unsigned offset)
+  {
+    auto index = (sq_tail_->load(std::memory_order_relaxed) + offset) & *sq_mask_;
+    auto sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    return sqe;
+  }
+
+  void publish(unsigned count)
+  {
+    sq_tail_->store(sq_tail_->load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+  // With the mutex held: submits everything queued without waiting, returning false if
+  // the kernel wouldn't take it
+  bool submit_queued();
+
+  // With the mutex held: waits until the operation's completions have all arrived,
+  // taking a turn at reaping them for every thread if nobody else is
+  void wait_for(Operation& operation, std::unique_lock<std::mutex>& lock);
+
+  // With the mutex held: hands out the completions which have arrived
+  void reap();
+
+  // With the mutex held, and no thread reaping: fails the operations whose entries the
+  // kernel hasn't taken
+  void take_back_unsubmitted(int error);
+
+  // With the mutex held, by the thread which was reaping: fails every operation in the ring
+  void fail_all(int error);
+
+  void tear_down();
+
+  std::mutex mutex_;
+  std::condition_variable completed_;
+  bool reaping_{ false };
+  std::vector<Operation*> operations_in_ring_;
+  std::atomic<bool> broken_{ false };
+
+  int fd_{ -1 };
+  void* sq_ptr_{ nullptr };
+  size_t sq_size_{ 0 };
+  void* cq_ptr_{ nullptr };
+  size_t cq_size_{ 0 };
+  io_uring_sqe* sqes_{ nullptr };
+  size_t sqes_size_{ 0 };
+  unsigned sq_entries_{ 0 };
+
+  // Pointers into the shared rings; the tails the kernel writes and the heads it reads
+  // are only accessed atomically
+  std::atomic<unsigned>* sq_head_{ nullptr };
+  std::atomic<unsigned>* sq_tail_{ nullptr };
+  unsigned* sq_mask_{ nullptr };
+  unsigned* sq_array_{ nullptr };
+  std::atomic<unsigned>* cq_head_{ nullptr };
+  std::atomic<unsigned>* cq_tail_{ nullptr };
+  unsigned* cq_mask_{ nullptr };
+  io_uring_cqe* cqes_{ nullptr };
+
+  std::vector<bool> fixed_buffers_in_use_; // Empty if the kernel has no sparse table
+  std::atomic<uint64_t> operations_{ 0 };
+  std::atomic<uint64_t> enter_calls_{ 0 };
+};
+
+inline bool
+IoUring::setup(unsigned entries)
+{
+  io_uring_params params{};
+  fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd_ < 0) {
+    broken_.store(true);
+    return false;
+  }
+
+  sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+  }
+
+  sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) {
+    sq_ptr_ = nullptr;
+    return false;
+  }
+  if (single_mmap) {
+    cq_ptr_ = sq_ptr_;
+  } else {
+    cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) {
+      cq_ptr_ = nullptr;
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  auto sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+  sq_entries_ = params.sq_entries;
+
+  auto sq = static_cast<char*>(sq_ptr_);
+  auto cq = static_cast<char*>(cq_ptr_);
+  sq_head_ = reinterpret_cast<std::atomic<unsigned>*>(sq + params.sq_off.head); // NOLINT
+  sq_tail_ = reinterpret_cast<std::atomic<unsigned>*>(sq + params.sq_off.tail); // NOLINT
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);          // NOLINT
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);             // NOLINT
+  cq_head_ = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.head);  // NOLINT
+  cq_tail_ = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.tail);  // NOLINT
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);          // NOLINT
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);              // NOLINT
+
+#ifdef IORING_RSRC_REGISTER_SPARSE
+  io_uring_rsrc_register table{};
+  table.nr = max_fixed_buffers;
+  table.flags = IORING_RSRC_REGISTER_SPARSE;
+  if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS2, &table, sizeof(table)) == 0) {
+    fixed_buffers_in_use_.assign(max_fixed_buffers, false);
+  }
+#endif
+  return true;
+}
+
+inline int
+IoUring::register_buffer(void* data, size_t size)
+{
+#ifdef IORING_RSRC_REGISTER_SPARSE
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto slot = std::find(fixed_buffers_in_use_.begin(), fixed_buffers_in_use_.end(), false);
+  if (!usable() || slot == fixed_buffers_in_use_.end()) {
+    errno = ENOSPC;
+    return -1;
+  }
+  auto index = static_cast<int>(slot - fixed_buffers_in_use_.begin());
+  iovec buffer = { data, size };
+  io_uring_rsrc_update2 update{};
+  update.offset = static_cast<uint32_t>(index);
+  update.data = reinterpret_cast<uint64_t>(&buffer); // NOLINT
+  update.nr = 1;
+  if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) != 1) {
+    return -1;
+  }
+  *slot = true;
+  return index;
+#else
+  (void)data;
+  (void)size;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+inline void
+IoUring::unregister_buffer(int index)
+{
+#ifdef IORING_RSRC_REGISTER_SPARSE
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index < 0 || static_cast<size_t>(index) >= fixed_buffers_in_use_.size() || !usable()) {
+    return;
+  }
+  // An empty iovec leaves the entry free again
+  iovec buffer = { nullptr, 0 };
+  io_uring_rsrc_update2 update{};
+  update.offset = static_cast<uint32_t>(index);
+  update.data = reinterpret_cast<uint64_t>(&buffer); // NOLINT
+  update.nr = 1;
+  syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+  fixed_buffers_in_use_[index] = false;
+#else
+  (void)index;
+#endif
+}
+
+template<typename Prepare>
+inline Status
+IoUring::submit_and_wait(Prepare prepare, clock_type::time_point deadline, int& result)
+{
+  Operation operation;
+  unsigned entries = deadline == clock_type::time_point::max() ? 1 : 2;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!usable() || (unsubmitted() + entries > sq_entries_ && !submit_queued())) {
+    result = -EBADF;
+    return Status::Error;
+  }
+
+  auto sqe = next_sqe(0);
+  prepare(*sqe);
+  sqe->user_data = reinterpret_cast<uint64_t>(&operation) | operation_tag; // NOLINT
+  if (entries == 2) {
+    auto remaining = std::max(deadline - clock_type::now(), clock_type::duration::zero());
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+    operation.timeout.tv_sec = seconds.count();
+    operation.timeout.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - seconds).count();
+
+    sqe->flags |= IOSQE_IO_LINK;
+    auto timeout = next_sqe(1);
+    timeout->opcode = IORING_OP_LINK_TIMEOUT;
+    timeout->fd = -1;
+    timeout->addr = reinterpret_cast<uint64_t>(&operation.timeout); // NOLINT
+    timeout->len = 1;
+    timeout->user_data = reinterpret_cast<uint64_t>(&operation) | timeout_tag; // NOLINT
+  }
+  // The two entries are linked, so they are only made visible to the kernel together
+  publish(entries);
+  operation.outstanding = entries;
+  operations_in_ring_.push_back(&operation);
+
+  // A thread already waiting in the kernel won't submit this until it wakes, so it's
+  // submitted here, along with anything else queued since. Otherwise this thread takes
+  // over the reaping, and submits it in the same call as it waits
+  if (reaping_) {
+    submit_queued();
+  }
+  wait_for(operation, lock);
+  operations_in_ring_.erase(std::find(operations_in_ring_.begin(), operations_in_ring_.end(), &operation));
+
+  result = operation.result;
+  if (operation.failed) {
+    return Status::Error;
+  }
+  operations_.fetch_add(1, std::memory_order_relaxed);
+  return operation.cancelled ? Status::Timeout : Status::Ok;
+}
+
+inline bool
+IoUring::submit_queued()
+{
+  while (unsubmitted() > 0) {
+    // The reaping thread may take some of the entries first, in which case there are
+    // fewer left, or none, for this call
+    auto rc = enter(unsubmitted(), 0, 0);
+    if (rc > 0 || (rc < 0 && errno == EINTR)) {
+      continue;
+    }
+    int error = rc < 0 ? errno : EBUSY;
+    if (rc == 0 && unsubmitted() == 0) {
+      break;
+    }
+    broken_.store(true, std::memory_order_release);
+    // While another thread is in io_uring_enter, it may be taking the entries, so they're
+    // left for it to submit, or fail when its own call does
+    if (!reaping_) {
+      take_back_unsubmitted(error);
+    }
+    return false;
+  }
+  return true;
+}
+
+inline void
+IoUring::wait_for(Operation& operation, std::unique_lock<std::mutex>& lock)
+{
+  while (operation.outstanding > 0) {
+    if (reaping_) {
+      completed_.wait(lock);
+      continue;
+    }
+
+    // Everything queued by now goes in with this call
+    reaping_ = true;
+    auto to_submit = unsubmitted();
+    lock.unlock();
+    auto rc = enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+    int error = errno;
+    lock.lock();
+    reaping_ = false;
+
+    reap();
+    if (rc < 0 && error != EINTR && error != EAGAIN && error != EBUSY) {
+      fail_all(error);
+    }
+    // Whoever is still waiting needs a thread to reap for them
+    completed_.notify_all();
+  }
+}
+
+inline void
+IoUring::reap()
+{
+  auto head = cq_head_->load(std::memory_order_relaxed);
+  while (head != cq_tail_->load(std::memory_order_acquire)) {
+    auto& cqe = cqes_[head & *cq_mask_];
+    auto operation = reinterpret_cast<Operation*>(cqe.user_data & ~tag_mask); // NOLINT
+    if ((cqe.user_data & tag_mask) == operation_tag) {
+      operation->result = cqe.res;
+      operation->cancelled = cqe.res == -ECANCELED;
+    }
+    if (operation->outstanding > 0) {
+      --operation->outstanding;
+    }
+    ++head;
+  }
+  cq_head_->store(head, std::memory_order_release);
+}
+
+inline void
+IoUring::take_back_unsubmitted(int error)
+{
+  // Without SQPOLL, the kernel only takes entries during io_uring_enter, which no other
+  // thread can be doing. An operation whose timeout is taken back, but which went in
+  // itself, still has its own completion to wait for
+  auto head = sq_head_->load(std::memory_order_acquire);
+  for (auto position = head; position != sq_tail_->load(std::memory_order_relaxed); ++position) {
+    auto& sqe = sqes_[sq_array_[position & *sq_mask_]];
+    auto operation = reinterpret_cast<Operation*>(sqe.user_data & ~tag_mask); // NOLINT
+    operation->result = -error;
+    operation->failed = true;
+    --operation->outstanding;
+  }
+  sq_tail_->store(head, std::memory_order_release);
+  broken_.store(true, std::memory_order_release);
+}
+
+inline void
+IoUring::fail_all(int error)
+{
+  take_back_unsubmitted(error);
+  // Closing the ring has the kernel cancel the operations in it
+  tear_down();
+  for (auto operation : operations_in_ring_) {
+    operation->result = -error;
+    operation->failed = true;
+    operation->outstanding = 0;
+  }
+}
+
+inline void
+IoUring::tear_down()
+{
+  broken_.store(true, std::memory_order_release);
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ptr_ && cq_ptr_ != sq_ptr_) {
+    munmap(cq_ptr_, cq_size_);
+  }
+  if (sq_ptr_) {
+    munmap(sq_ptr_, sq_size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  sqes_ = nullptr;
+  cq_ptr_ = nullptr;
+  sq_ptr_ = nullptr;
+  fd_ = -1;
+  fixed_buffers_in_use_.clear();
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_PLUGINS_IOURING_HPP_
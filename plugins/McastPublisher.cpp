@@ -0,0 +1,256 @@
+/**
+ *
+ * @file McastPublisher.cpp McastPublisher messaging class definitions
+ *
+ * McastPublisher sends each message once, to the UDP multicast group in
+ * its connection string, however many subscribers have joined it. Messages
+ * are split into datagrams (see McastSocket.hpp), and all the datagrams of
+ * a message, or of a batch of messages, go out together in as few
+ * sendmmsg calls as will take them. Each datagram is gathered straight
+ * from the caller's buffers.
+ *
+ * Nothing is acknowledged, so a send completes once the kernel has taken
+ * the datagrams. A message cut off by its deadline partway through counts
+ * as sent, and its subscribers drop it as incomplete
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "McastPublisher"
+
+#include "McastSocket.hpp"
+
+#include "ipm/Sender.hpp"
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class McastPublisher : public Sender
+{
+public:
+  ~McastPublisher() override { close_socket(); }
+
+  bool can_send() const noexcept override { return fd_ >= 0; }
+  // -Throws McastSocketError if the group or interface aren't valid, or the socket can't be set up
+  void connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    connection_string_ = connection_info.value<std::string>("connection_string", "udp://239.192.0.1:5700");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string_;
+    datagram_size_ = std::clamp(connection_info.value<size_t>("datagram_size", mcast::default_datagram_size),
+                                sizeof(mcast::DatagramHeader) + 1,
+                                mcast::max_datagram_size);
+    auto group = mcast::resolve(connection_string_);
+    auto interface = mcast::interface_address(connection_info.value<std::string>("interface", ""), connection_string_);
+    int ttl = connection_info.value<int>("ttl", 1);
+    int loop = connection_info.value<bool>("multicast_loop", true) ? 1 : 0;
+    int buffer_size = connection_info.value<int>("socket_buffer_size", mcast::default_socket_buffer_size);
+
+    close_socket();
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    if (setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0 ||
+        ::connect(fd_, reinterpret_cast<sockaddr*>(&group), sizeof(group)) != 0) { // NOLINT
+      int error = errno;
+      close_socket();
+      throw McastSocketError(ERS_HERE, "Setting up the socket", connection_string_, std::strerror(error));
+    }
+
+    // Subscribers tell publishers apart by this, and a new one starts its sequence afresh
+    std::random_device random;
+    publisher_ = (static_cast<uint64_t>(random()) << 32) | random();
+    next_sequence_ = 0;
+  }
+
+protected:
+  void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  // -Throws McastSocketError if the topic doesn't fit in a datagram
+  Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    iovec part = { const_cast<void*>(message), static_cast<size_t>(N) }; // NOLINT
+    clear_datagrams();
+    add_message(&part, 1, metadata);
+    return write_datagrams(mcast::deadline_for(timeout));
+  }
+
+  // The parts are gathered into a single message
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& metadata) override
+  {
+    std::vector<iovec> parts;
+    for (size_t i = 0; i < message_sizes.size(); ++i) {
+      parts.push_back({ const_cast<void*>(message_parts[i]), static_cast<size_t>(message_sizes[i]) }); // NOLINT
+    }
+    clear_datagrams();
+    add_message(parts.data(), parts.size(), metadata);
+    check_status(write_datagrams(mcast::deadline_for(timeout)), timeout);
+  }
+
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& metadata) override
+  {
+    std::vector<iovec> parts;
+    for (auto const& part : message_parts) {
+      parts.push_back({ const_cast<char*>(part.data()), static_cast<size_t>(part.size()) }); // NOLINT
+    }
+    clear_datagrams();
+    add_message(parts.data(), parts.size(), metadata);
+    check_status(write_datagrams(mcast::deadline_for(timeout)), timeout);
+  }
+
+  // The datagrams of all the messages are written together, so a batch of small
+  // messages takes as few system calls as one message
+  void send_batch_(const std::vector<BatchEntry>& messages, const duration_type& timeout) override
+  {
+    clear_datagrams();
+    for (auto const& entry : messages) {
+      if (entry.size > 0) {
+        iovec part = { const_cast<void*>(entry.message), static_cast<size_t>(entry.size) }; // NOLINT
+        add_message(&part, 1, entry.metadata);
+      }
+    }
+    check_status(write_datagrams(mcast::deadline_for(timeout)), timeout);
+  }
+
+private:
+  // Where each datagram's iovecs are in iov_; its header is the one in headers_ at the
+  // same index
+  struct Datagram
+  {
+    size_t first_iov;
+    size_t iov_count;
+  };
+
+  void clear_datagrams()
+  {
+    headers_.clear();
+    iov_.clear();
+    datagrams_.clear();
+  }
+
+  // Splits the topic followed by the parts into datagrams. The iovecs for the headers
+  // are filled in by write_datagrams, once headers_ has stopped growing
+  void add_message(const iovec* parts, size_t nparts, std::string_view topic)
+  {
+    auto capacity = datagram_size_ - sizeof(mcast::DatagramHeader);
+    if (topic.size() > capacity) {
+      throw McastSocketError(ERS_HERE, "Sending", connection_string_, "the topic doesn't fit in a datagram");
+    }
+
+    pieces_.clear();
+    if (!topic.empty()) {
+      pieces_.push_back({ const_cast<char*>(topic.data()), topic.size() }); // NOLINT
+    }
+    uint64_t payload_size = 0;
+    for (size_t i = 0; i < nparts; ++i) {
+      if (parts[i].iov_len > 0) {
+        pieces_.push_back(parts[i]);
+        payload_size += parts[i].iov_len;
+      }
+    }
+
+    mcast::DatagramHeader header{
+      mcast::datagram_magic, static_cast<uint32_t>(topic.size()), publisher_, next_sequence_++, payload_size, 0
+    };
+    auto piece = pieces_.begin();
+    size_t used = 0; // Of *piece
+    while (piece != pieces_.end()) {
+      headers_.push_back(header);
+      Datagram datagram{ iov_.size(), 1 };
+      iov_.push_back({ nullptr, sizeof(header) });
+      for (auto room = capacity; room > 0 && piece != pieces_.end();) {
+        auto n = std::min(room, piece->iov_len - used);
+        iov_.push_back({ static_cast<char*>(piece->iov_base) + used, n });
+        ++datagram.iov_count;
+        room -= n;
+        header.offset += n;
+        used += n;
+        if (used == piece->iov_len) {
+          ++piece;
+          used = 0;
+        }
+      }
+      datagrams_.push_back(datagram);
+    }
+  }
+
+  // Writes out the datagrams, waiting until the deadline whenever the socket is full.
+  // Once any have gone out, the rest are dropped if the deadline passes
+  Status write_datagrams(mcast::clock_type::time_point deadline)
+  {
+    messages_.resize(datagrams_.size());
+    for (size_t i = 0; i < datagrams_.size(); ++i) {
+      iov_[datagrams_[i].first_iov].iov_base = &headers_[i];
+      messages_[i] = mmsghdr{};
+      messages_[i].msg_hdr.msg_iov = &iov_[datagrams_[i].first_iov];
+      messages_[i].msg_hdr.msg_iovlen = datagrams_[i].iov_count;
+    }
+
+    size_t next = 0;
+    while (next < messages_.size()) {
+      auto count = static_cast<unsigned>(std::min<size_t>(messages_.size() - next, UIO_MAXIOV));
+      int rc = sendmmsg(fd_, &messages_[next], count, 0);
+      if (rc > 0) {
+        next += rc;
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      auto status = Status::Error;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        status = mcast::wait_for(fd_, POLLOUT, deadline);
+        if (status == Status::Ok) {
+          continue;
+        }
+      }
+      return next > 0 && status == Status::Timeout ? Status::Ok : status;
+    }
+    return Status::Ok;
+  }
+
+  void close_socket()
+  {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+  }
+
+  std::string connection_string_;
+  size_t datagram_size_{ mcast::default_datagram_size };
+  int fd_{ -1 };
+  uint64_t publisher_{ 0 };
+  uint64_t next_sequence_{ 0 };
+
+  // These are kept between sends to save the allocations
+  std::vector<iovec> pieces_;
+  std::vector<mcast::DatagramHeader> headers_;
+  std::vector<iovec> iov_;
+  std::vector<Datagram> datagrams_;
+  std::vector<mmsghdr> messages_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::McastPublisher)
@@ -0,0 +1,122 @@
+/**
+ *
+ * @file McastSocket.hpp Datagram format and socket routines shared by McastPublisher and McastSubscriber
+ *
+ * The multicast transport splits each message into datagrams which fit
+ * the configured datagram size. Each one starts with a DatagramHeader
+ * naming the publisher, the message's sequence number and where in the
+ * message the datagram's bytes go. The topic comes first, and has to fit
+ * in the first datagram, so that a subscriber can tell from it whether to
+ * keep the rest. The header is in host byte order, as the transport is
+ * meant for hosts of the same architecture.
+ *
+ * Multicast is unreliable: a message with a datagram missing, or arriving
+ * out of order, is dropped, and a gap in the sequence numbers tells the
+ * subscriber that messages were lost
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_MCASTSOCKET_HPP_
+#define IPM_PLUGINS_MCASTSOCKET_HPP_
+
+#include "TcpSocket.hpp"
+
+#include "ers/Issue.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm,
+                  McastSocketError,
+                  operation << " failed for " << connection_string << ": " << error,
+                  ((std::string)operation)((std::string)connection_string)((std::string)error))
+} // namespace dunedaq
+
+namespace dunedaq::ipm::mcast {
+
+// The deadline and waiting routines are the same as for TCP
+using tcp::clock_type;
+using tcp::deadline_for;
+using tcp::status_for;
+using tcp::wait_for;
+
+static constexpr uint32_t datagram_magic = 0x44504d49; // "IPMD"
+static constexpr size_t default_datagram_size = 1472;  // Fills a 1500-byte Ethernet frame
+static constexpr size_t max_datagram_size = 65507;
+static constexpr int default_socket_buffer_size = 4 << 20;
+
+struct DatagramHeader
+{
+  uint32_t magic;
+  uint32_t topic_size;
+  uint64_t publisher;
+  uint64_t sequence;
+  uint64_t payload_size;
+  uint64_t offset; // Of the datagram's bytes in the topic followed by the payload
+};
+
+// Resolves "udp://group:port", where the group has to be a multicast address
+// -Throws McastSocketError if it isn't, or the port isn't a number from 0 to 65535
+inline sockaddr_in
+resolve(std::string const& connection_string)
+{
+  std::string address = connection_string;
+  auto scheme = address.find("://");
+  if (scheme != std::string::npos) {
+    address.erase(0, scheme + 3);
+  }
+  auto colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    throw McastSocketError(ERS_HERE, "Parsing the address", connection_string, "no port given");
+  }
+
+  auto port_string = address.substr(colon + 1);
+  int port = -1;
+  try {
+    size_t end = 0;
+    port = std::stoi(port_string, &end);
+    if (end != port_string.size()) {
+      port = -1;
+    }
+  } catch (std::logic_error const&) {
+    // std::invalid_argument or std::out_of_range
+  }
+  if (port < 0 || port > UINT16_MAX) {
+    throw McastSocketError(ERS_HERE, "Parsing the address", connection_string, "not a valid port");
+  }
+
+  sockaddr_in group{};
+  group.sin_family = AF_INET;
+  group.sin_port = htons(static_cast<uint16_t>(port));
+  if (inet_pton(AF_INET, address.substr(0, colon).c_str(), &group.sin_addr) != 1 ||
+      !IN_MULTICAST(ntohl(group.sin_addr.s_addr))) {
+    throw McastSocketError(ERS_HERE, "Parsing the address", connection_string, "not an IPv4 multicast group");
+  }
+  return group;
+}
+
+// The local address of the interface to send or join on; an empty string lets the
+// kernel choose from the routing table
+// -Throws McastSocketError if the address isn't valid
+inline in_addr
+interface_address(std::string const& interface, std::string const& connection_string)
+{
+  in_addr address{};
+  address.s_addr = htonl(INADDR_ANY);
+  if (!interface.empty() && inet_pton(AF_INET, interface.c_str(), &address) != 1) {
+    throw McastSocketError(ERS_HERE, "Parsing the interface address", connection_string, interface);
+  }
+  return address;
+}
+
+} // namespace dunedaq::ipm::mcast
+
+#endif // IPM_PLUGINS_MCASTSOCKET_HPP_
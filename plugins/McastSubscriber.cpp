@@ -0,0 +1,334 @@
+/**
+ *
+ * @file McastSubscriber.cpp McastSubscriber messaging class definitions
+ *
+ * McastSubscriber joins the UDP multicast group in its connection string
+ * and puts the messages back together from their datagrams (see
+ * McastSocket.hpp). Datagrams are read in batches with recvmmsg, so a run
+ * of small messages takes few system calls.
+ *
+ * Topics are filtered here rather than by the publisher, which sends
+ * everything to everyone: a message is kept if its topic starts with one
+ * that has been subscribed to, as with ZmqSubscriber, and the rest of its
+ * datagrams are skipped otherwise. Messages are put together in blocks from
+ * the BufferPool. Messages which arrive incomplete are dropped, and gaps
+ * in a publisher's sequence numbers are logged. The sizes in a message's
+ * first datagram come from the network, so a message larger than
+ * max_message_size is dropped before anything is allocated for it.
+ *
+ * Publishers come and go, each with a new random ID, so one which hasn't
+ * been heard from for publisher_timeout is forgotten, along with any
+ * message of its still being put together. statistics() reports how many
+ * publishers are being kept track of
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "McastSubscriber"
+
+#include "McastSocket.hpp"
+
+#include "ipm/BufferPool.hpp"
+#include "ipm/Subscriber.hpp"
+#include "ipm/ThreadPlacement.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class McastSubscriber : public Subscriber
+{
+public:
+  static constexpr size_t datagrams_per_read = 64;
+  static constexpr size_t default_max_message_size = size_t{ 1 } << 30;
+  static constexpr std::chrono::milliseconds default_publisher_timeout{ 10000 };
+
+  ~McastSubscriber() override { close_socket(); }
+
+  bool can_receive() const noexcept override { return fd_ >= 0; }
+  // -Throws McastSocketError if the group or interface aren't valid, or the group can't be joined
+  void connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    connection_string_ = connection_info.value<std::string>("connection_string", "udp://239.192.0.1:5700");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string_;
+    // Datagrams larger than the publisher's would be cut short, so this can't be smaller
+    datagram_size_ = std::clamp(connection_info.value<size_t>("datagram_size", mcast::default_datagram_size),
+                                sizeof(mcast::DatagramHeader) + 1,
+                                mcast::max_datagram_size);
+    max_message_size_ = connection_info.value<size_t>("max_message_size", default_max_message_size);
+    publisher_timeout_ = std::chrono::milliseconds(
+      connection_info.value<int64_t>("publisher_timeout_ms", default_publisher_timeout.count()));
+    auto group = mcast::resolve(connection_string_);
+    ip_mreq membership{};
+    membership.imr_multiaddr = group.sin_addr;
+    membership.imr_interface =
+      mcast::interface_address(connection_info.value<std::string>("interface", ""), connection_string_);
+    // Multicast has no flow control, so the kernel buffer is all that absorbs a burst
+    int buffer_size = connection_info.value<int>("socket_buffer_size", mcast::default_socket_buffer_size);
+
+    close_socket();
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    // Any number of subscribers on a host can join the same group
+    int reuse = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&group), sizeof(group)) != 0 || // NOLINT
+        setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+      int error = errno;
+      close_socket();
+      throw McastSocketError(ERS_HERE, "Joining the group", connection_string_, std::strerror(error));
+    }
+
+    buffer_.resize(datagrams_per_read * datagram_size_);
+    iov_.resize(datagrams_per_read);
+    messages_.resize(datagrams_per_read);
+    for (size_t i = 0; i < datagrams_per_read; ++i) {
+      iov_[i] = { buffer_.data() + i * datagram_size_, datagram_size_ };
+      messages_[i] = mmsghdr{};
+      messages_[i].msg_hdr.msg_iov = &iov_[i];
+      messages_[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  void subscribe(std::string const& topic) override { topics_.push_back(topic); }
+  void unsubscribe(std::string const& topic) override
+  {
+    auto subscription = std::find(topics_.begin(), topics_.end(), topic);
+    if (subscription != topics_.end()) {
+      topics_.erase(subscription);
+    }
+  }
+
+  void move_buffers_to_local_node() override { placement::move_to_local_node(buffer_.data(), buffer_.size()); }
+
+  nlohmann::json statistics() const override
+  {
+    return { { "publishers", publisher_count_.load(std::memory_order_relaxed) } };
+  }
+
+protected:
+  Receiver::Response receive_(const duration_type& timeout) override
+  {
+    auto result = try_receive_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::Response> try_receive_(const duration_type& timeout) override
+  {
+    auto message = try_receive_buffer_(timeout);
+    Result<Receiver::Response> result;
+    result.status = message.status;
+    result->metadata.assign(message->metadata.begin(), message->metadata.end());
+    result->data.assign(message->data.begin(), message->data.end());
+    return result;
+  }
+
+  Receiver::BufferResponse receive_buffer_(const duration_type& timeout) override
+  {
+    auto result = try_receive_buffer_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    Result<Receiver::BufferResponse> result;
+    result.status = receive_message(result.value, mcast::deadline_for(timeout));
+    return result;
+  }
+
+private:
+  // What is known of each publisher, and the message of its being put together, if any
+  struct Publisher
+  {
+    uint64_t next_sequence{ 0 };
+    bool assembling{ false };
+    mcast::DatagramHeader header{};
+    MessageBuffer topic; // From the first datagram, as it will be handed out
+    BufferPool::Block payload;
+    uint64_t received{ 0 }; // Of the topic and payload
+    mcast::clock_type::time_point last_heard;
+  };
+
+  // Goes through the datagrams already read before reading more, waiting until the
+  // deadline when there are none
+  Status receive_message(BufferResponse& output, mcast::clock_type::time_point deadline)
+  {
+    while (true) {
+      while (next_ < read_) {
+        if (take_datagram(next_++, output)) {
+          return Status::Ok;
+        }
+      }
+
+      int rc = recvmmsg(fd_, messages_.data(), datagrams_per_read, 0, nullptr);
+      if (rc > 0) {
+        read_ = static_cast<size_t>(rc);
+        next_ = 0;
+        // The datagrams are all taken to have arrived now, which saves reading the clock
+        // for each of them
+        read_time_ = mcast::clock_type::now();
+        if (read_time_ >= next_sweep_) {
+          forget_idle_publishers();
+        }
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return mcast::status_for(errno);
+      }
+      auto status = mcast::wait_for(fd_, POLLIN, deadline);
+      if (status != Status::Ok) {
+        return status;
+      }
+    }
+  }
+
+  // Adds the datagram to its message, returning true if that completes it
+  bool take_datagram(size_t index, BufferResponse& output)
+  {
+    auto const& message = messages_[index].msg_hdr;
+    auto size = static_cast<size_t>(messages_[index].msg_len);
+    auto data = buffer_.data() + index * datagram_size_;
+    mcast::DatagramHeader header;
+    if (size < sizeof(header) || (message.msg_flags & MSG_TRUNC)) {
+      TLOG(TLVL_DEBUG) << "Dropping a datagram of " << size << " bytes, which is more than datagram_size or too short";
+      return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != mcast::datagram_magic) {
+      return false;
+    }
+    data += sizeof(header);
+    size -= sizeof(header);
+
+    auto [entry, inserted] = publishers_.try_emplace(header.publisher);
+    auto& publisher = entry->second;
+    publisher.last_heard = read_time_;
+    if (inserted) {
+      // Whatever a publisher sent before it was heard from wasn't lost, just not received
+      publisher.next_sequence = header.offset == 0 ? header.sequence : header.sequence + 1;
+      publisher_count_.store(publishers_.size(), std::memory_order_relaxed);
+    }
+    if (header.offset == 0) {
+      // Sequence numbers are only checked at the start of each message, which is why
+      // messages that aren't subscribed to still have to be looked at
+      if (publisher.assembling) {
+        lost(header.publisher, 1);
+      }
+      if (header.sequence > publisher.next_sequence) {
+        lost(header.publisher, header.sequence - publisher.next_sequence);
+      }
+      publisher.next_sequence = header.sequence + 1;
+      publisher.assembling = false;
+      if (header.topic_size > size || !subscribed(std::string_view(data, header.topic_size))) {
+        return false;
+      }
+      if (header.payload_size > max_message_size_ || header.topic_size > max_message_size_ - header.payload_size) {
+        TLOG(TLVL_WARNING) << "Dropping a message of " << header.topic_size + header.payload_size
+                           << " bytes from publisher " << std::hex << header.publisher << std::dec
+                           << ", which is more than the max_message_size of " << max_message_size_;
+        return false;
+      }
+      publisher.assembling = true;
+      publisher.header = header;
+      publisher.topic = BufferPool::instance().copy(data, header.topic_size);
+      publisher.payload = BufferPool::instance().allocate(header.payload_size);
+      publisher.received = 0;
+    } else if (!publisher.assembling || header.sequence != publisher.header.sequence) {
+      // Either part of a message which isn't wanted, or its start was lost
+      return false;
+    }
+
+    auto topic_size = publisher.header.topic_size;
+    auto payload_size = publisher.header.payload_size;
+    auto payload_offset = std::max<uint64_t>(header.offset, topic_size) - topic_size;
+    auto skip = std::min<uint64_t>(size, topic_size - std::min<uint64_t>(header.offset, topic_size));
+    if (header.offset != publisher.received || payload_offset + (size - skip) > payload_size) {
+      // A datagram has gone missing or been reordered, so the message can't be completed
+      publisher.assembling = false;
+      lost(header.publisher, 1);
+      return false;
+    }
+    std::memcpy(publisher.payload.data() + payload_offset, data + skip, size - skip);
+    publisher.received += size;
+    if (publisher.received < topic_size + payload_size) {
+      return false;
+    }
+
+    output.metadata = std::move(publisher.topic);
+    if (payload_size > 0) {
+      output.data = std::move(publisher.payload).to_message_buffer(static_cast<MessageBuffer::size_type>(payload_size));
+    }
+    publisher.assembling = false;
+    return true;
+  }
+
+  bool subscribed(std::string_view topic) const
+  {
+    return std::any_of(topics_.begin(), topics_.end(), [&](std::string const& subscription) {
+      return topic.substr(0, subscription.size()) == subscription;
+    });
+  }
+
+  void forget_idle_publishers()
+  {
+    for (auto it = publishers_.begin(); it != publishers_.end();) {
+      it = read_time_ - it->second.last_heard > publisher_timeout_ ? publishers_.erase(it) : std::next(it);
+    }
+    publisher_count_.store(publishers_.size(), std::memory_order_relaxed);
+    next_sweep_ = read_time_ + publisher_timeout_;
+  }
+
+  void lost(uint64_t publisher, uint64_t count)
+  {
+    TLOG(TLVL_WARNING) << count << " message(s) from publisher " << std::hex << publisher << std::dec
+                       << " were lost on " << connection_string_;
+  }
+
+  void close_socket()
+  {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+    next_ = read_ = 0;
+    publishers_.clear();
+    publisher_count_.store(0, std::memory_order_relaxed);
+  }
+
+  std::string connection_string_;
+  size_t datagram_size_{ mcast::default_datagram_size };
+  size_t max_message_size_{ default_max_message_size };
+  std::chrono::milliseconds publisher_timeout_{ default_publisher_timeout };
+  int fd_{ -1 };
+  std::vector<std::string> topics_;
+  std::unordered_map<uint64_t, Publisher> publishers_;
+  std::atomic<size_t> publisher_count_{ 0 };
+  mcast::clock_type::time_point next_sweep_;
+
+  // Datagrams [next_, read_) of the last recvmmsg haven't been looked at yet
+  std::vector<char> buffer_;
+  std::vector<iovec> iov_;
+  std::vector<mmsghdr> messages_;
+  size_t next_{ 0 };
+  size_t read_{ 0 };
+  mcast::clock_type::time_point read_time_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::McastSubscriber)
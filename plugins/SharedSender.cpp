@@ -0,0 +1,18 @@
+/**
+ *
+ * @file SharedSender.cpp SharedSender plugin definitions
+ *
+ * Makes the SharedSender decorator (see SharedSender.hpp) available through
+ * makeIPMSender, for when the Sender to be shared is itself a plugin
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "SharedSender"
+
+#include "ipm/SharedSender.hpp"
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::SharedSender)
@@ -0,0 +1,108 @@
+/**
+ *
+ * @file ShmReceiver.cpp ShmReceiver messaging class definitions
+ *
+ * ShmReceiver reads the messages a ShmSender writes to a shared memory
+ * ring (see ShmRing.hpp). receive_buffer hands out the data where it lies
+ * in the ring, and its space is only reused once the MessageBuffer has
+ * been released, so buffers which are held on to will eventually stall
+ * the sender
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "ShmReceiver"
+
+#include "ShmRing.hpp"
+
+#include "ipm/Receiver.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace ipm {
+
+class ShmReceiver : public Receiver
+{
+public:
+  static constexpr size_t default_segment_size = 64 << 20;
+
+  bool can_receive() const noexcept override { return ring_ != nullptr; }
+  void connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    std::string connection_string = connection_info.value<std::string>("connection_string", "shm://default");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+    ring_ = ShmRing::open(
+      connection_string, connection_info.value<size_t>("segment_size", default_segment_size), false);
+  }
+
+protected:
+  Receiver::Response receive_(const duration_type& timeout) override
+  {
+    auto result = try_receive_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::Response> try_receive_(const duration_type& timeout) override
+  {
+    Result<Receiver::Response> result;
+    ShmRing::Record record;
+    result.status = ring_->read(record, ShmRing::deadline_for(timeout));
+    if (result.status == Status::Ok) {
+      result->data.assign(record.data, record.data + record.data_size);
+      result->metadata.assign(record.metadata, record.metadata_size);
+      ring_->release(record.position);
+    }
+    return result;
+  }
+
+  Receiver::BufferResponse receive_buffer_(const duration_type& timeout) override
+  {
+    auto result = try_receive_buffer_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  // The metadata is small, so it's copied and only the data is left in the ring
+  Result<Receiver::BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    Result<Receiver::BufferResponse> result;
+    ShmRing::Record record;
+    result.status = ring_->read(record, ShmRing::deadline_for(timeout));
+    if (result.status != Status::Ok) {
+      return result;
+    }
+
+    if (record.metadata_size > 0) {
+      result->metadata = MessageBuffer::adopt(std::string(record.metadata, record.metadata_size));
+    }
+    auto in_place = new InPlaceRecord{ ring_, record.position };
+    result->data = MessageBuffer(record.data, static_cast<size_type>(record.data_size), in_place, [](void* owner) {
+      auto in_place = static_cast<InPlaceRecord*>(owner);
+      in_place->ring->release(in_place->position);
+      delete in_place; // NOLINT
+    });
+    return result;
+  }
+
+private:
+  // Keeps the segment mapped for as long as a MessageBuffer points into it
+  struct InPlaceRecord
+  {
+    std::shared_ptr<ShmRing> ring;
+    uint64_t position;
+  };
+
+  std::shared_ptr<ShmRing> ring_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::ShmReceiver)
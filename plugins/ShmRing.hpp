@@ -0,0 +1,507 @@
+/**
+ *
+ * @file ShmRing.hpp Shared-memory ring buffer used by ShmSender and ShmReceiver
+ *
+ * A ShmRing maps a POSIX shared memory segment named after the connection
+ * string ("shm://name" becomes "/ipm_name"). The segment holds a single
+ * producer, single consumer ring of variable-size records, each of which
+ * is a header followed by the data and then the metadata. Records never
+ * wrap around the end of the ring, so the receiver can hand out the data
+ * in place; the space is only given back to the sender once the consumer
+ * releases it. A record may be at most half the ring, which guarantees it
+ * always fits once the ring has drained.
+ *
+ * Either side waits on a futex in the segment header, after a short spin,
+ * and is only woken by the other side when it has said it is waiting.
+ *
+ * Each side records its process ID in the segment header. A segment which
+ * outlived a crash keeps its positions, and records which will never be
+ * released; so whichever side opens it while the other side's process
+ * isn't running starts the ring afresh. Likewise, whichever side closes
+ * it last removes its name, so that either side can be restarted while
+ * the other carries on with the same segment. Both are done holding an
+ * flock on the segment, from opening it until its header is set up. The
+ * record sizes are 32 bits, so the ring can be at most 4 GiB.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_SHMRING_HPP_
+#define IPM_PLUGINS_SHMRING_HPP_
+
+#include "ipm/Status.hpp"
+
+#include "ers/Issue.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm,
+                  SharedMemoryError,
+                  operation << " failed for shared memory segment " << name << ": " << error,
+                  ((std::string)operation)((std::string)name)((std::string)error))
+ERS_DECLARE_ISSUE(ipm,
+                  MessageTooLarge,
+                  "Message of " << size << " bytes is larger than the maximum of " << max_size << " bytes",
+                  ((size_t)size)((size_t)max_size))
+ERS_DECLARE_ISSUE(ipm,
+                  SegmentTooLarge,
+                  "A shared memory segment_size of " << size << " bytes is larger than the maximum of " << max_size
+                                                       << " bytes",
+                  ((size_t)size)((size_t)max_size))
+} // namespace dunedaq
+
+namespace dunedaq::ipm {
+
+class ShmRing
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  // What the consumer gets for each record; the data and metadata stay in the segment
+  // until release() is called with the record's position
+  struct Record
+  {
+    const char* data{ nullptr };
+    size_t data_size{ 0 };
+    const char* metadata{ nullptr };
+    size_t metadata_size{ 0 };
+    uint64_t position{ 0 };
+  };
+
+  // The ring's record sizes are 32 bits
+  static constexpr size_t max_capacity = size_t{ 1 } << 32;
+
+  // Both sides open the segment, creating it if it doesn't exist yet with a ring of
+  // at least "capacity" bytes; if it does exist, its size is kept. The segment's name
+  // is removed when the last side using it destroys its ShmRing
+  // -Throws SegmentTooLarge if "capacity" is more than max_capacity
+  static std::shared_ptr<ShmRing> open(std::string const& connection_string, size_t capacity, bool producer);
+
+  ~ShmRing()
+  {
+    flock(fd_, LOCK_EX);
+    auto pid = static_cast<int32_t>(getpid());
+    own_pid().compare_exchange_strong(pid, 0);
+    // A segment whose name has already gone mustn't take its successor's with it
+    struct stat status;
+    if (!process_running(peer_pid().load()) && fstat(fd_, &status) == 0 && status.st_nlink > 0) {
+      shm_unlink(name_.c_str());
+    }
+    flock(fd_, LOCK_UN);
+    munmap(segment_, segment_size_);
+    close(fd_);
+  }
+
+  size_t max_message_size() const noexcept { return capacity_ / 2 - sizeof(RecordHeader); }
+
+  // Producer side: writes the parts one after another as the data of one record, waiting
+  // for space in the ring until the deadline
+  // -Throws MessageTooLarge if the record can't fit in half the ring
+  Status write(const void* const* parts,
+               const size_t* sizes,
+               size_t nparts,
+               std::string_view metadata,
+               clock_type::time_point deadline);
+
+  // Consumer side: waits until the deadline for the next record
+  Status read(Record& record, clock_type::time_point deadline);
+
+  // Consumer side, from any thread: gives the record's space back once it's done with.
+  // Records may be released in any order
+  void release(uint64_t position);
+
+  static clock_type::time_point deadline_for(std::chrono::milliseconds timeout)
+  {
+    auto now = clock_type::now();
+    if (timeout == std::chrono::milliseconds::max() ||
+        timeout >= std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::time_point::max() - now)) {
+      return clock_type::time_point::max();
+    }
+    return now + timeout;
+  }
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+
+  ShmRing(ShmRing&&) = delete;
+  ShmRing& operator=(ShmRing&&) = delete;
+
+private:
+  static constexpr size_t cache_line_size = 64;
+  static constexpr size_t record_alignment = 16;
+  static constexpr uint32_t wrap_marker = UINT32_MAX; // metadata_size of the padding at the end of the ring
+  static constexpr int spin_count = 1000;
+
+  // At the start of the segment. All zeroes is a valid, empty ring, so a newly created
+  // segment needs no initialisation and it doesn't matter which side creates it
+  struct Header
+  {
+    alignas(cache_line_size) std::atomic<uint64_t> head; // Up to here has been released by the consumer
+    std::atomic<uint32_t> space_seq;                     // Futex the producer waits on for space
+    std::atomic<uint32_t> producer_waiting;
+    std::atomic<int32_t> consumer_pid;                   // 0 if there's no consumer
+    alignas(cache_line_size) std::atomic<uint64_t> tail; // Up to here has been written by the producer
+    std::atomic<uint32_t> data_seq;                      // Futex the consumer waits on for data
+    std::atomic<uint32_t> consumer_waiting;
+    std::atomic<int32_t> producer_pid; // 0 if there's no producer
+  };
+
+  struct RecordHeader
+  {
+    uint32_t size; // Of the whole record, including this header and the padding after it
+    uint32_t data_size;
+    uint32_t metadata_size;
+    std::atomic<uint32_t> released;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<int32_t>::is_always_lock_free,
+                "Atomics shared between processes have to be lock-free");
+  static_assert(sizeof(RecordHeader) == record_alignment, "Record data should stay aligned");
+
+  // Only called with the segment locked, so the two sides don't both check for a
+  // crashed peer at once. The ShmRing keeps "fd" to lock the segment again when closing
+  ShmRing(std::string name, int fd, void* segment, size_t segment_size, bool producer)
+    : name_(std::move(name))
+    , fd_(fd)
+    , segment_(segment)
+    , segment_size_(segment_size)
+    , producer_(producer)
+    , header_(static_cast<Header*>(segment))
+    , ring_(static_cast<char*>(segment) + sizeof(Header))
+    , capacity_(segment_size - sizeof(Header))
+    , mask_(capacity_ - 1)
+  {
+    if (!process_running(peer_pid().load())) {
+      header_->head.store(0, std::memory_order_relaxed);
+      header_->tail.store(0, std::memory_order_relaxed);
+      header_->producer_waiting.store(0, std::memory_order_relaxed);
+      header_->consumer_waiting.store(0, std::memory_order_relaxed);
+    }
+    own_pid().store(static_cast<int32_t>(getpid()));
+
+    head_cache_ = header_->head.load(std::memory_order_acquire);
+    tail_cache_ = header_->tail.load(std::memory_order_acquire);
+    read_pos_.store(head_cache_, std::memory_order_relaxed);
+  }
+
+  std::atomic<int32_t>& own_pid() const { return producer_ ? header_->producer_pid : header_->consumer_pid; }
+  std::atomic<int32_t>& peer_pid() const { return producer_ ? header_->consumer_pid : header_->producer_pid; }
+
+  static bool process_running(int32_t pid) { return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM); }
+
+  RecordHeader* record_at(uint64_t position) const
+  {
+    return reinterpret_cast<RecordHeader*>(ring_ + (position & mask_)); // NOLINT
+  }
+
+  static size_t align(size_t size) { return (size + record_alignment - 1) & ~(record_alignment - 1); }
+
+  static void cpu_relax()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Spins, then sleeps on the futex until "ready" is true or the deadline passes
+  template<typename Predicate>
+  static Status wait_on(std::atomic<uint32_t>& seq,
+                        std::atomic<uint32_t>& waiting,
+                        clock_type::time_point deadline,
+                        Predicate ready);
+
+  static void wake(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+      seq.fetch_add(1, std::memory_order_release);
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAKE, 1, nullptr, nullptr, 0); // NOLINT
+    }
+  }
+
+  std::string name_;
+  int fd_;
+  void* segment_;
+  size_t segment_size_;
+  bool producer_;
+  Header* header_;
+  char* ring_;
+  size_t capacity_;
+  size_t mask_;
+
+  // The producer's last view of head, and the consumer's last view of tail
+  uint64_t head_cache_{ 0 };
+  uint64_t tail_cache_{ 0 };
+
+  // The consumer has read up to here; release() may be called from other threads
+  std::atomic<uint64_t> read_pos_{ 0 };
+  std::mutex release_mutex_;
+};
+
+inline std::shared_ptr<ShmRing>
+ShmRing::open(std::string const& connection_string, size_t capacity, bool producer)
+{
+  if (capacity > max_capacity) {
+    throw SegmentTooLarge(ERS_HERE, capacity, max_capacity);
+  }
+
+  // Shared memory names are a single path component starting with '/'
+  std::string name = connection_string;
+  auto scheme = name.find("://");
+  if (scheme != std::string::npos) {
+    name.erase(0, scheme + 3);
+  }
+  std::replace(name.begin(), name.end(), '/', '_');
+  name = "/ipm_" + name;
+
+  // The segment stays locked from here until its header is set up, so that the two
+  // sides don't both size it, or both check for a crashed peer, at once
+  int fd = -1;
+  struct stat status;
+  auto failed = [&](const char* operation, std::string const& error) {
+    flock(fd, LOCK_UN);
+    close(fd);
+    return SharedMemoryError(ERS_HERE, operation, name, error);
+  };
+  while (true) {
+    fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0660);
+    if (fd < 0) {
+      throw SharedMemoryError(ERS_HERE, "shm_open", name, std::strerror(errno));
+    }
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &status) != 0) {
+      throw failed("fstat", std::strerror(errno));
+    }
+    // If the last side using the segment removed its name while this one waited for
+    // the lock, the segment is on its way out, and the name is free for a new one
+    if (status.st_nlink > 0) {
+      break;
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+  }
+
+  // The ring's size is a power of two, so that positions can be masked
+  size_t ring_size = record_alignment;
+  while (ring_size < capacity) {
+    ring_size <<= 1;
+  }
+  size_t segment_size = sizeof(Header) + ring_size;
+
+  if (status.st_size == 0) {
+    if (ftruncate(fd, static_cast<off_t>(segment_size)) != 0) {
+      throw failed("ftruncate", std::strerror(errno));
+    }
+  } else {
+    segment_size = static_cast<size_t>(status.st_size);
+    ring_size = segment_size - sizeof(Header);
+    if (segment_size <= sizeof(Header) || ring_size > max_capacity || (ring_size & (ring_size - 1)) != 0) {
+      throw failed("open", "existing segment has an unexpected size");
+    }
+  }
+
+  void* segment = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (segment == MAP_FAILED) {
+    throw failed("mmap", std::strerror(errno));
+  }
+
+  std::shared_ptr<ShmRing> ring(new ShmRing(name, fd, segment, segment_size, producer));
+  // The ShmRing keeps the file open, and with it the lock, so it's unlocked explicitly
+  flock(fd, LOCK_UN);
+  return ring;
+}
+
+template<typename Predicate>
+inline Status
+ShmRing::wait_on(std::atomic<uint32_t>& seq,
+                 std::atomic<uint32_t>& waiting,
+                 clock_type::time_point deadline,
+                 Predicate ready)
+{
+  for (int i = 0; i < spin_count; ++i) {
+    if (ready()) {
+      return Status::Ok;
+    }
+    cpu_relax();
+  }
+
+  while (true) {
+    auto expected = seq.load(std::memory_order_acquire);
+    waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ready()) {
+      waiting.store(0, std::memory_order_relaxed);
+      return Status::Ok;
+    }
+
+    timespec timeout{};
+    timespec* timeout_ptr = nullptr;
+    if (deadline != clock_type::time_point::max()) {
+      auto remaining = deadline - clock_type::now();
+      if (remaining <= clock_type::duration::zero()) {
+        waiting.store(0, std::memory_order_relaxed);
+        return Status::Timeout;
+      }
+      auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+      timeout.tv_sec = seconds.count();
+      timeout.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - seconds).count();
+      timeout_ptr = &timeout;
+    }
+
+    // The futex is shared between processes, so FUTEX_PRIVATE_FLAG can't be used
+    long rc = syscall(
+      SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAIT, expected, timeout_ptr, nullptr, 0); // NOLINT
+    waiting.store(0, std::memory_order_relaxed);
+    if (rc != 0 && errno == EINTR) {
+      return Status::Interrupted;
+    }
+  }
+}
+
+inline Status
+ShmRing::write(const void* const* parts,
+               const size_t* sizes,
+               size_t nparts,
+               std::string_view metadata,
+               clock_type::time_point deadline)
+{
+  size_t data_size = 0;
+  for (size_t i = 0; i < nparts; ++i) {
+    data_size += sizes[i];
+  }
+  size_t needed = align(sizeof(RecordHeader) + data_size + metadata.size());
+  if (needed > capacity_ / 2) {
+    throw MessageTooLarge(ERS_HERE, data_size + metadata.size(), max_message_size());
+  }
+
+  // A record which won't fit before the end of the ring is put at the start, after
+  // padding out the end
+  auto tail = header_->tail.load(std::memory_order_relaxed);
+  size_t contiguous = capacity_ - (tail & mask_);
+  size_t total = contiguous < needed ? contiguous + needed : needed;
+
+  auto has_space = [&] {
+    head_cache_ = header_->head.load(std::memory_order_acquire);
+    return capacity_ - (tail - head_cache_) >= total;
+  };
+  if (capacity_ - (tail - head_cache_) < total) {
+    auto status = wait_on(header_->space_seq, header_->producer_waiting, deadline, has_space);
+    if (status != Status::Ok) {
+      return status;
+    }
+  }
+
+  auto position = tail;
+  if (contiguous < needed) {
+    auto padding = record_at(position);
+    padding->size = static_cast<uint32_t>(contiguous);
+    padding->data_size = 0;
+    padding->metadata_size = wrap_marker;
+    padding->released.store(0, std::memory_order_relaxed);
+    position += contiguous;
+  }
+
+  auto record = record_at(position);
+  record->size = static_cast<uint32_t>(needed);
+  record->data_size = static_cast<uint32_t>(data_size);
+  record->metadata_size = static_cast<uint32_t>(metadata.size());
+  record->released.store(0, std::memory_order_relaxed);
+  auto out = reinterpret_cast<char*>(record + 1); // NOLINT
+  for (size_t i = 0; i < nparts; ++i) {
+    std::memcpy(out, parts[i], sizes[i]);
+    out += sizes[i];
+  }
+  std::memcpy(out, metadata.data(), metadata.size());
+
+  header_->tail.store(tail + total, std::memory_order_release);
+  wake(header_->data_seq, header_->consumer_waiting);
+  return Status::Ok;
+}
+
+inline Status
+ShmRing::read(Record& output, clock_type::time_point deadline)
+{
+  while (true) {
+    auto position = read_pos_.load(std::memory_order_relaxed);
+    if (position == tail_cache_) {
+      auto has_data = [&] {
+        tail_cache_ = header_->tail.load(std::memory_order_acquire);
+        return position != tail_cache_;
+      };
+      if (!has_data()) {
+        auto status = wait_on(header_->data_seq, header_->consumer_waiting, deadline, has_data);
+        if (status != Status::Ok) {
+          return status;
+        }
+      }
+    }
+
+    auto record = record_at(position);
+    read_pos_.store(position + record->size, std::memory_order_release);
+    if (record->metadata_size == wrap_marker) {
+      // Nothing to hand out, but the padding has to be passed over when releasing
+      record->released.store(1, std::memory_order_release);
+      continue;
+    }
+
+    auto data = reinterpret_cast<const char*>(record + 1); // NOLINT
+    output.data = data;
+    output.data_size = record->data_size;
+    output.metadata = data + record->data_size;
+    output.metadata_size = record->metadata_size;
+    output.position = position;
+    return Status::Ok;
+  }
+}
+
+inline void
+ShmRing::release(uint64_t position)
+{
+  record_at(position)->released.store(1, std::memory_order_release);
+
+  // The head only moves past records which have all been released, in order
+  std::lock_guard<std::mutex> lock(release_mutex_);
+  auto head = header_->head.load(std::memory_order_relaxed);
+  auto end = read_pos_.load(std::memory_order_acquire);
+  auto start = head;
+  while (head != end) {
+    auto record = record_at(head);
+    if (!record->released.load(std::memory_order_acquire)) {
+      break;
+    }
+    head += record->size;
+  }
+  if (head != start) {
+    header_->head.store(head, std::memory_order_release);
+    wake(header_->space_seq, header_->producer_waiting);
+  }
+}
+
+} // namespace dunedaq::ipm
+
+#endif // IPM_PLUGINS_SHMRING_HPP_
@@ -0,0 +1,88 @@
+/**
+ *
+ * @file ShmSender.cpp ShmSender messaging class definitions
+ *
+ * ShmSender writes each message straight from the caller's buffer into a
+ * shared memory ring (see ShmRing.hpp) which a ShmReceiver in the same or
+ * another process on this host reads from. Only one ShmSender may write to
+ * a given segment, and it can be restarted while the ShmReceiver carries on
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "ShmSender"
+
+#include "ShmRing.hpp"
+
+#include "ipm/Sender.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class ShmSender : public Sender
+{
+public:
+  static constexpr size_t default_segment_size = 64 << 20;
+
+  bool can_send() const noexcept override { return ring_ != nullptr; }
+  void connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    std::string connection_string = connection_info.value<std::string>("connection_string", "shm://default");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+    ring_ = ShmRing::open(
+      connection_string, connection_info.value<size_t>("segment_size", default_segment_size), true);
+  }
+
+protected:
+  void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    const void* parts[] = { message };
+    size_t sizes[] = { static_cast<size_t>(N) };
+    return ring_->write(parts, sizes, 1, metadata, ShmRing::deadline_for(timeout));
+  }
+
+  // The parts are gathered into a single message
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& metadata) override
+  {
+    std::vector<size_t> sizes(message_sizes.begin(), message_sizes.end());
+    check_status(ring_->write(message_parts, sizes.data(), sizes.size(), metadata, ShmRing::deadline_for(timeout)),
+                 timeout);
+  }
+
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& metadata) override
+  {
+    std::vector<const void*> parts;
+    std::vector<size_t> sizes;
+    for (auto const& part : message_parts) {
+      parts.push_back(part.data());
+      sizes.push_back(static_cast<size_t>(part.size()));
+    }
+    check_status(ring_->write(parts.data(), sizes.data(), sizes.size(), metadata, ShmRing::deadline_for(timeout)),
+                 timeout);
+  }
+
+private:
+  std::shared_ptr<ShmRing> ring_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::ShmSender)
@@ -0,0 +1,31 @@
+/**
+ *
+ * @file TcpReceiver.cpp TcpReceiver messaging class definitions
+ *
+ * TcpReceiver is the TCP Receiver (see TcpReceiverImpl.hpp) which uses
+ * plain socket calls
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "TcpReceiver"
+
+#include "TcpReceiverImpl.hpp"
+
+namespace dunedaq {
+namespace ipm {
+class TcpReceiver : public TcpReceiverImpl
+{
+public:
+  TcpReceiver()
+    : TcpReceiverImpl(TcpReceiverImpl::Backend::Socket)
+  {}
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::TcpReceiver)
@@ -0,0 +1,444 @@
+/**
+ *
+ * @file TcpReceiverImpl.hpp Common implementation of the TCP Receivers
+ *
+ * TcpReceiverImpl listens on the address in its connection string for the
+ * sender which connects to it, and reads its frames (see TcpSocket.hpp).
+ * Reads go through a buffer allocated up front, so that a run of small
+ * frames takes few system calls, while the bulk of a large payload is read
+ * straight into the memory handed out with it. That memory is a block from
+ * the BufferPool. Waiting for data is done with epoll. A frame whose header
+ * claims more than max_message_size bytes is refused before anything is
+ * allocated for it, and the connection dropped.
+ *
+ * With the Uring backend, each read and the wait for it are submitted
+ * together to the io_uring which every Uring plugin in the process shares
+ * (see IoUring.hpp), and the buffer is registered with the ring so that
+ * reads into it use IORING_OP_READ_FIXED. If the kernel doesn't support
+ * io_uring, or the ring fails, the plain socket calls are used instead.
+ * statistics() reports whether there is a ring, how many reads this
+ * receiver made through it, whether the buffer is registered, and how many
+ * operations the shared ring has made
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef IPM_PLUGINS_TCPRECEIVERIMPL_HPP_
+#define IPM_PLUGINS_TCPRECEIVERIMPL_HPP_
+
+#include "IoUring.hpp"
+#include "TcpSocket.hpp"
+
+#include "TRACE/trace.h"
+
+#include "ipm/BufferPool.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/ThreadPlacement.hpp"
+
+#include <sys/epoll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class TcpReceiverImpl : public Receiver
+{
+public:
+  enum class Backend
+  {
+    Socket,
+    Uring,
+  };
+
+  static constexpr size_t default_receive_buffer_size = 1 << 20;
+  static constexpr size_t default_max_message_size = size_t{ 1 } << 30;
+
+  explicit TcpReceiverImpl(Backend backend)
+  {
+    if (backend == Backend::Uring) {
+      ring_ = IoUring::shared();
+      if (!ring_) {
+        TLOG(TLVL_WARNING) << "io_uring is not available, so plain socket calls will be used";
+      }
+    }
+  }
+
+  ~TcpReceiverImpl() override
+  {
+    close_sockets();
+    if (ring_) {
+      ring_->unregister_buffer(receive_buffer_index_);
+    }
+  }
+
+  bool can_receive() const noexcept override { return listen_fd_ >= 0; }
+  // -Throws TcpSocketError if the address can't be listened on
+  void connect_for_receives(const nlohmann::json& connection_info) override
+  {
+    connection_string_ = connection_info.value<std::string>("connection_string", "tcp://*:5555");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string_;
+    socket_buffer_size_ = connection_info.value<int>("socket_buffer_size", tcp::default_socket_buffer_size);
+    no_delay_ = connection_info.value<bool>("tcp_nodelay", true);
+    // The buffer may move, so the ring mustn't be left pointing at it
+    if (ring_) {
+      ring_->unregister_buffer(receive_buffer_index_);
+      receive_buffer_index_ = -1;
+    }
+    buffer_.resize(connection_info.value<size_t>("receive_buffer_size", default_receive_buffer_size));
+    max_message_size_ = connection_info.value<size_t>("max_message_size", default_max_message_size);
+    // Reads into the buffer work without it being registered, just less efficiently,
+    // for instance if it is larger than the locked memory limit allows
+    if (use_ring() && (receive_buffer_index_ = ring_->register_buffer(buffer_.data(), buffer_.size())) < 0) {
+      TLOG(TLVL_DEBUG) << "Couldn't register the receive buffer with io_uring: " << std::strerror(errno);
+    }
+    socklen_t length = 0;
+    auto address = tcp::resolve(connection_string_, length);
+
+    close_sockets();
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+      throw TcpSocketError(ERS_HERE, "Making a socket", connection_string_, std::strerror(errno));
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    // Accepted sockets inherit the buffer sizes, which have to be set before the
+    // connection is made for the TCP window to scale to them
+    tcp::configure(listen_fd_, socket_buffer_size_, no_delay_);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), length) != 0 || listen(listen_fd_, 1) != 0) { // NOLINT
+      int error = errno;
+      close_sockets();
+      throw TcpSocketError(ERS_HERE, "Listening", connection_string_, std::strerror(error));
+    }
+    // The kernel completes a sender's connection straight away, and it is accepted by
+    // the next receive
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    watch(listen_fd_, true);
+  }
+
+  // A registered buffer's pages are pinned in place, so only an unregistered one moves
+  void move_buffers_to_local_node() override
+  {
+    if (receive_buffer_index_ < 0) {
+      placement::move_to_local_node(buffer_.data(), buffer_.size());
+    }
+  }
+
+  nlohmann::json statistics() const override
+  {
+    return { { "io_uring", ring_ != nullptr },
+             { "io_uring_operations", operations_.load() },
+             { "io_uring_fixed_buffer", receive_buffer_index_ >= 0 },
+             { "io_uring_ring_operations", ring_ ? ring_->operations() : 0 } };
+  }
+
+protected:
+  Receiver::Response receive_(const duration_type& timeout) override
+  {
+    auto result = try_receive_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::Response> try_receive_(const duration_type& timeout) override
+  {
+    auto message = try_receive_buffer_(timeout);
+    Result<Receiver::Response> result;
+    result.status = message.status;
+    result->metadata.assign(message->metadata.begin(), message->metadata.end());
+    result->data.assign(message->data.begin(), message->data.end());
+    return result;
+  }
+
+  Receiver::BufferResponse receive_buffer_(const duration_type& timeout) override
+  {
+    auto result = try_receive_buffer_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    Result<Receiver::BufferResponse> result;
+    result.status = receive_frame(result.value, tcp::deadline_for(timeout));
+    return result;
+  }
+
+private:
+  // A frame which has only partly arrived, kept until the next call if the deadline passes
+  struct PartialFrame
+  {
+    bool started{ false };
+    tcp::FrameHeader header{};
+    BufferPool::Block topic;
+    BufferPool::Block payload;
+    size_t received{ 0 }; // Of the topic and payload
+  };
+
+  Status receive_frame(BufferResponse& output, tcp::clock_type::time_point deadline)
+  {
+    auto status = accept(deadline);
+    while (status == Status::Ok && !partial_.started) {
+      if (end_ - begin_ >= sizeof(tcp::FrameHeader)) {
+        status = start_frame();
+      } else {
+        status = fill(deadline);
+      }
+    }
+
+    auto topic_size = static_cast<size_t>(partial_.header.topic_size);
+    auto frame_size = topic_size + partial_.header.payload_size;
+    while (status == Status::Ok && partial_.received < frame_size) {
+      char* destination = nullptr;
+      size_t wanted = 0;
+      if (partial_.received < topic_size) {
+        destination = partial_.topic.data() + partial_.received;
+        wanted = topic_size - partial_.received;
+      } else {
+        destination = partial_.payload.data() + (partial_.received - topic_size);
+        wanted = frame_size - partial_.received;
+      }
+
+      if (end_ > begin_) {
+        auto n = std::min(wanted, end_ - begin_);
+        std::memcpy(destination, buffer_.data() + begin_, n);
+        begin_ += n;
+        partial_.received += n;
+      } else if (wanted >= buffer_.size() / 2) {
+        // Large pieces are read where they're going, rather than through the buffer
+        size_t n = 0;
+        status = read_some(destination, wanted, n, deadline);
+        partial_.received += n;
+      } else {
+        status = fill(deadline);
+      }
+    }
+    if (status != Status::Ok) {
+      return status;
+    }
+
+    if (topic_size > 0) {
+      output.metadata = std::move(partial_.topic).to_message_buffer(static_cast<MessageBuffer::size_type>(topic_size));
+    }
+    if (partial_.header.payload_size > 0) {
+      output.data = std::move(partial_.payload)
+                      .to_message_buffer(static_cast<MessageBuffer::size_type>(partial_.header.payload_size));
+    }
+    partial_ = PartialFrame();
+    return Status::Ok;
+  }
+
+  Status start_frame()
+  {
+    std::memcpy(&partial_.header, buffer_.data() + begin_, sizeof(tcp::FrameHeader));
+    if (partial_.header.magic != tcp::frame_magic) {
+      // The stream is out of step, and can only be recovered by starting again
+      disconnect();
+      return Status::Error;
+    }
+    // The sizes come from the wire, so they're checked before anything is allocated
+    if (partial_.header.payload_size > max_message_size_ ||
+        partial_.header.topic_size > max_message_size_ - partial_.header.payload_size) {
+      TLOG(TLVL_WARNING) << "Dropping the connection on " << connection_string_ << ", which sent a frame of "
+                         << partial_.header.topic_size + partial_.header.payload_size
+                         << " bytes, more than the max_message_size of " << max_message_size_;
+      disconnect();
+      return Status::Error;
+    }
+    begin_ += sizeof(tcp::FrameHeader);
+    partial_.started = true;
+    if (partial_.header.topic_size > 0) {
+      partial_.topic = BufferPool::instance().allocate(partial_.header.topic_size);
+    }
+    partial_.payload = BufferPool::instance().allocate(partial_.header.payload_size);
+    partial_.received = 0;
+    return Status::Ok;
+  }
+
+  // Moves what's left in the buffer to its start, then reads as much as will fit after it
+  Status fill(tcp::clock_type::time_point deadline)
+  {
+    if (begin_ > 0) {
+      std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+      end_ -= begin_;
+      begin_ = 0;
+    }
+    size_t n = 0;
+    auto status = read_some(buffer_.data() + end_, buffer_.size() - end_, n, deadline);
+    end_ += n;
+    return status;
+  }
+
+  // Reads whatever is available, up to "size" bytes, waiting until the deadline if nothing is
+  Status read_some(char* destination, size_t size, size_t& n, tcp::clock_type::time_point deadline)
+  {
+    if (use_ring()) {
+      return read_some_uring(destination, size, n, deadline);
+    }
+    while (true) {
+      auto got = recv(fd_, destination, size, 0);
+      if (got > 0) {
+        n = static_cast<size_t>(got);
+        return Status::Ok;
+      }
+      if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        auto status = wait_readable(deadline);
+        if (status != Status::Ok) {
+          return status;
+        }
+        continue;
+      }
+      if (got < 0 && errno == EINTR) {
+        return Status::Interrupted;
+      }
+      // The sender has gone, so the next call waits for another
+      disconnect();
+      return Status::Error;
+    }
+  }
+
+  Status read_some_uring(char* destination, size_t size, size_t& n, tcp::clock_type::time_point deadline)
+  {
+    bool fixed = receive_buffer_index_ >= 0 && destination >= buffer_.data() &&
+                 destination + size <= buffer_.data() + buffer_.size();
+    int result = 0;
+    auto status = ring_->submit_and_wait(
+      [&](io_uring_sqe& sqe) {
+        sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_RECV;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<uint64_t>(destination); // NOLINT
+        sqe.len = static_cast<uint32_t>(std::min<size_t>(size, UINT32_MAX));
+        if (fixed) {
+          sqe.buf_index = static_cast<uint16_t>(receive_buffer_index_);
+        }
+      },
+      deadline,
+      result);
+    if (status == Status::Ok) {
+      ++operations_;
+    }
+    if (status == Status::Error) {
+      // Whatever the read got is lost, so the stream is out of step
+      if (!ring_->usable()) {
+        TLOG(TLVL_WARNING) << "io_uring failed, so plain socket calls will be used";
+      }
+      disconnect();
+      return status;
+    }
+    if (status != Status::Ok) {
+      return status;
+    }
+    if (result > 0) {
+      n = static_cast<size_t>(result);
+      return Status::Ok;
+    }
+    if (result == -EINTR) {
+      return Status::Interrupted;
+    }
+    disconnect();
+    return Status::Error;
+  }
+
+  // Takes the next connection if there isn't one, waiting until the deadline
+  Status accept(tcp::clock_type::time_point deadline)
+  {
+    while (fd_ < 0) {
+      // io_uring waits for data itself, which it only does for blocking sockets
+      int fd = accept4(listen_fd_, nullptr, nullptr, use_ring() ? SOCK_CLOEXEC : SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd >= 0) {
+        tcp::configure(fd, 0, no_delay_);
+        fd_ = fd;
+        // Only the connection is watched while there is one
+        watch(listen_fd_, false);
+        watch(fd_, true);
+        break;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) {
+        return tcp::status_for(errno);
+      }
+      auto status = wait_readable(deadline);
+      if (status != Status::Ok) {
+        return status;
+      }
+    }
+    return Status::Ok;
+  }
+
+  bool use_ring() const noexcept { return ring_ && ring_->usable(); }
+
+  Status wait_readable(tcp::clock_type::time_point deadline)
+  {
+    epoll_event event;
+    int rc = epoll_wait(epoll_fd_, &event, 1, tcp::timeout_for(deadline));
+    if (rc < 0) {
+      return tcp::status_for(errno);
+    }
+    return rc == 0 ? Status::Timeout : Status::Ok;
+  }
+
+  void watch(int fd, bool on)
+  {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, on ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &event);
+  }
+
+  void close_sockets()
+  {
+    disconnect();
+    for (auto fd : { listen_fd_, epoll_fd_ }) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+    listen_fd_ = -1;
+    epoll_fd_ = -1;
+  }
+
+  // Anything buffered or partly received is from the old connection, so it goes too
+  void disconnect()
+  {
+    if (fd_ >= 0) {
+      watch(fd_, false);
+      close(fd_);
+      if (listen_fd_ >= 0) {
+        watch(listen_fd_, true);
+      }
+    }
+    fd_ = -1;
+    begin_ = end_ = 0;
+    partial_ = PartialFrame();
+  }
+
+  std::shared_ptr<IoUring> ring_;
+  std::atomic<uint64_t> operations_{ 0 };
+  int receive_buffer_index_{ -1 }; // The buffer's index in the ring, if registered
+  std::string connection_string_;
+  int socket_buffer_size_{ tcp::default_socket_buffer_size };
+  bool no_delay_{ true };
+  size_t max_message_size_{ default_max_message_size };
+  int listen_fd_{ -1 };
+  int epoll_fd_{ -1 };
+  int fd_{ -1 };
+
+  // Bytes [begin_, end_) of the buffer have been read but not used yet
+  std::vector<char> buffer_;
+  size_t begin_{ 0 };
+  size_t end_{ 0 };
+  PartialFrame partial_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_PLUGINS_TCPRECEIVERIMPL_HPP_
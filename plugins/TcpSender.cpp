@@ -0,0 +1,31 @@
+/**
+ *
+ * @file TcpSender.cpp TcpSender messaging class definitions
+ *
+ * TcpSender is the TCP Sender (see TcpSenderImpl.hpp) which uses
+ * plain socket calls
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "TcpSender"
+
+#include "TcpSenderImpl.hpp"
+
+namespace dunedaq {
+namespace ipm {
+class TcpSender : public TcpSenderImpl
+{
+public:
+  TcpSender()
+    : TcpSenderImpl(TcpSenderImpl::Backend::Socket)
+  {}
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::TcpSender)
@@ -0,0 +1,446 @@
+/**
+ *
+ * @file TcpSenderImpl.hpp Common implementation of the TCP Senders
+ *
+ * TcpSenderImpl connects to the receiver listening on the address in its
+ * connection string, retrying until the deadline of each send while
+ * nothing is there, and sends it length-prefixed frames (see TcpSocket.hpp).
+ * Each frame goes out in a single gathering sendmsg, taking the header,
+ * topic and payload parts straight from the caller's buffers, and a batch
+ * of messages goes out the same way as one run of frames. If the receiver
+ * goes away, the send fails and the next one connects again.
+ *
+ * With the Uring backend, the sendmsg and the wait for room in the socket
+ * are submitted together to the io_uring which every Uring plugin in the
+ * process shares (see IoUring.hpp). A send buffer of "send_buffer_size"
+ * bytes (64 KiB by default) is registered with the ring, and a run of
+ * frames which fits in it is copied there and written with
+ * IORING_OP_WRITE_FIXED; larger ones are gathered with sendmsg as before.
+ * If the kernel doesn't support io_uring, or the ring fails, the plain
+ * socket calls are used instead. statistics() reports whether there is a
+ * ring, how many writes this sender made through it, whether the send
+ * buffer is registered, and how many operations the shared ring has made
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_TCPSENDERIMPL_HPP_
+#define IPM_PLUGINS_TCPSENDERIMPL_HPP_
+
+#include "IoUring.hpp"
+#include "TcpSocket.hpp"
+
+#include "TRACE/trace.h"
+
+#include "ipm/Sender.hpp"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace ipm {
+
+class TcpSenderImpl : public Sender
+{
+public:
+  enum class Backend
+  {
+    Socket,
+    Uring,
+  };
+
+  static constexpr std::chrono::milliseconds connect_retry_interval{ 10 };
+
+  static constexpr std::chrono::milliseconds close_timeout{ 100 };
+
+  static constexpr size_t default_send_buffer_size = 64 << 10;
+
+  explicit TcpSenderImpl(Backend backend)
+  {
+    if (backend == Backend::Uring) {
+      ring_ = IoUring::shared();
+      if (!ring_) {
+        TLOG(TLVL_WARNING) << "io_uring is not available, so plain socket calls will be used";
+      }
+    }
+  }
+
+  // The end of the last frame may still be waiting to go out
+  ~TcpSenderImpl() override
+  {
+    if (connected_ && !unsent_.empty()) {
+      iov_.assign(1, { unsent_.data(), unsent_.size() });
+      write_frames(tcp::deadline_for(close_timeout));
+    }
+    disconnect();
+    if (ring_) {
+      ring_->unregister_buffer(send_buffer_index_);
+    }
+  }
+
+  bool can_send() const noexcept override { return address_length_ > 0; }
+
+  nlohmann::json statistics() const override
+  {
+    return { { "io_uring", ring_ != nullptr },
+             { "io_uring_operations", operations_.load() },
+             { "io_uring_fixed_buffer", send_buffer_index_ >= 0 },
+             { "io_uring_ring_operations", ring_ ? ring_->operations() : 0 } };
+  }
+
+  // -Throws TcpSocketError if the address can't be resolved, or no socket can be made
+  void connect_for_sends(const nlohmann::json& connection_info) override
+  {
+    connection_string_ = connection_info.value<std::string>("connection_string", "tcp://localhost:5555");
+    TLOG(TLVL_INFO) << "Connection String is " << connection_string_;
+    socket_buffer_size_ = connection_info.value<int>("socket_buffer_size", tcp::default_socket_buffer_size);
+    no_delay_ = connection_info.value<bool>("tcp_nodelay", true);
+    address_ = tcp::resolve(connection_string_, address_length_);
+    if (use_ring()) {
+      register_send_buffer(connection_info.value<size_t>("send_buffer_size", default_send_buffer_size));
+    }
+
+    // The receiver may not be there yet, in which case the sends try again
+    disconnect();
+    connect(tcp::clock_type::now());
+  }
+
+protected:
+  void send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  Status try_send_(const void* message, size_type N, const duration_type& timeout, std::string const& metadata) override
+  {
+    iovec part = { const_cast<void*>(message), static_cast<size_t>(N) }; // NOLINT
+    return send_frame(&part, 1, metadata, tcp::deadline_for(timeout));
+  }
+
+  // The parts are gathered into a single frame
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& metadata) override
+  {
+    std::vector<iovec> parts;
+    for (size_t i = 0; i < message_sizes.size(); ++i) {
+      parts.push_back({ const_cast<void*>(message_parts[i]), static_cast<size_t>(message_sizes[i]) }); // NOLINT
+    }
+    check_status(send_frame(parts.data(), parts.size(), metadata, tcp::deadline_for(timeout)), timeout);
+  }
+
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& metadata) override
+  {
+    std::vector<iovec> parts;
+    for (auto const& part : message_parts) {
+      parts.push_back({ const_cast<char*>(part.data()), static_cast<size_t>(part.size()) }); // NOLINT
+    }
+    check_status(send_frame(parts.data(), parts.size(), metadata, tcp::deadline_for(timeout)), timeout);
+  }
+
+  // All the frames are written together, so a batch of small messages takes as few
+  // system calls as one message. Like a single frame, the batch counts as sent once any
+  // of it has gone out
+  void send_batch_(const std::vector<BatchEntry>& messages, const duration_type& timeout) override
+  {
+    auto deadline = tcp::deadline_for(timeout);
+    auto status = start_frames(deadline);
+    if (status == Status::Ok) {
+      headers_.clear();
+      headers_.reserve(messages.size()); // So the iov_ entries pointing into it stay valid
+      for (auto const& entry : messages) {
+        if (entry.size > 0) {
+          iovec part = { const_cast<void*>(entry.message), static_cast<size_t>(entry.size) }; // NOLINT
+          add_frame(&part, 1, entry.metadata);
+        }
+      }
+      status = write_frames(deadline);
+    }
+    check_status(status, timeout);
+  }
+
+private:
+  Status send_frame(const iovec* parts, size_t nparts, std::string_view topic, tcp::clock_type::time_point deadline)
+  {
+    auto status = start_frames(deadline);
+    if (status != Status::Ok) {
+      return status;
+    }
+    headers_.clear();
+    headers_.reserve(1);
+    add_frame(parts, nparts, topic);
+    return write_frames(deadline);
+  }
+
+  // Connects if need be and writes out what's left of the last frame, then clears iov_
+  // for the next frames. Nothing new can go out until all of the last frame has
+  Status start_frames(tcp::clock_type::time_point deadline)
+  {
+    auto status = connect(deadline);
+    if (status == Status::Ok && !unsent_.empty()) {
+      iov_.assign(1, { unsent_.data(), unsent_.size() });
+      status = write_frames(deadline);
+      if (status == Status::Ok && !unsent_.empty()) {
+        status = Status::Timeout;
+      }
+    }
+    iov_.clear();
+    return status;
+  }
+
+  void add_frame(const iovec* parts, size_t nparts, std::string_view topic)
+  {
+    auto& header = headers_.emplace_back(tcp::FrameHeader{ tcp::frame_magic, static_cast<uint32_t>(topic.size()), 0 });
+    iov_.push_back({ &header, sizeof(header) });
+    if (!topic.empty()) {
+      iov_.push_back({ const_cast<char*>(topic.data()), topic.size() }); // NOLINT
+    }
+    for (size_t i = 0; i < nparts; ++i) {
+      if (parts[i].iov_len > 0) {
+        iov_.push_back(parts[i]);
+        header.payload_size += parts[i].iov_len;
+      }
+    }
+  }
+
+  // Writes out iov_, waiting until the deadline whenever the socket is full. If the
+  // deadline passes partway through, the rest is kept in unsent_ and written before the
+  // next frame, and the frames count as sent
+  Status write_frames(tcp::clock_type::time_point deadline)
+  {
+    stage_in_send_buffer();
+    size_t next = 0;
+    bool started = false;
+    while (next < iov_.size()) {
+      msghdr msg{};
+      msg.msg_iov = &iov_[next];
+      msg.msg_iovlen = std::min<size_t>(iov_.size() - next, IOV_MAX);
+      size_t sent = 0;
+      auto status = send_some(msg, sent, deadline);
+      if (status == Status::Error) {
+        // The receiver has gone, so the next send connects again
+        disconnect();
+        return status;
+      }
+      if (status != Status::Ok) {
+        if (status == Status::Interrupted && started) {
+          continue;
+        }
+        if (started) {
+          keep_unsent(next);
+          return Status::Ok;
+        }
+        return status;
+      }
+
+      started = true;
+      while (next < iov_.size() && sent >= iov_[next].iov_len) {
+        sent -= iov_[next].iov_len;
+        ++next;
+      }
+      if (sent > 0) {
+        iov_[next].iov_base = static_cast<char*>(iov_[next].iov_base) + sent;
+        iov_[next].iov_len -= sent;
+      }
+    }
+    unsent_.clear();
+    return Status::Ok;
+  }
+
+  // Sends as much of "msg" as the socket takes, waiting until the deadline if it's full
+  Status send_some(msghdr& msg, size_t& sent, tcp::clock_type::time_point deadline)
+  {
+    if (use_ring()) {
+      auto first = static_cast<char*>(msg.msg_iov[0].iov_base);
+      bool fixed = send_buffer_index_ >= 0 && msg.msg_iovlen == 1 && first >= send_buffer_.data() &&
+                   first + msg.msg_iov[0].iov_len <= send_buffer_.data() + send_buffer_.size();
+      int result = 0;
+      auto status = ring_->submit_and_wait(
+        [&](io_uring_sqe& sqe) {
+          sqe.fd = fd_;
+          if (fixed) {
+            sqe.opcode = IORING_OP_WRITE_FIXED;
+            sqe.addr = reinterpret_cast<uint64_t>(first); // NOLINT
+            sqe.len = static_cast<uint32_t>(msg.msg_iov[0].iov_len);
+            sqe.buf_index = static_cast<uint16_t>(send_buffer_index_);
+          } else {
+            sqe.opcode = IORING_OP_SENDMSG;
+            sqe.addr = reinterpret_cast<uint64_t>(&msg); // NOLINT
+            sqe.len = 1;
+            sqe.msg_flags = MSG_NOSIGNAL;
+          }
+        },
+        deadline,
+        result);
+      if (status == Status::Ok) {
+        ++operations_;
+      }
+      if (status == Status::Error && !ring_->usable()) {
+        TLOG(TLVL_WARNING) << "io_uring failed, so plain socket calls will be used";
+      }
+      if (status != Status::Ok || result >= 0) {
+        sent = std::max(result, 0);
+        return status;
+      }
+      return tcp::status_for(-result);
+    }
+
+    while (true) {
+      auto rc = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+      if (rc >= 0) {
+        sent = static_cast<size_t>(rc);
+        return Status::Ok;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return tcp::status_for(errno);
+      }
+      auto status = tcp::wait_for(fd_, POLLOUT, deadline);
+      if (status != Status::Ok) {
+        return status;
+      }
+    }
+  }
+
+  // Copies iov_ into the registered send buffer, if it fits, so that it goes out with
+  // IORING_OP_WRITE_FIXED. A larger run is gathered from the caller's buffers as it is
+  void stage_in_send_buffer()
+  {
+    if (send_buffer_index_ < 0 || !use_ring() || iov_.empty()) {
+      return;
+    }
+    size_t total = 0;
+    for (auto const& part : iov_) {
+      total += part.iov_len;
+    }
+    if (total > send_buffer_.size()) {
+      return;
+    }
+    auto out = send_buffer_.data();
+    for (auto const& part : iov_) {
+      out = std::copy_n(static_cast<const char*>(part.iov_base), part.iov_len, out);
+    }
+    iov_.assign(1, { send_buffer_.data(), total });
+  }
+
+  void register_send_buffer(size_t size)
+  {
+    ring_->unregister_buffer(send_buffer_index_);
+    send_buffer_.assign(size, 0);
+    send_buffer_index_ = size > 0 ? ring_->register_buffer(send_buffer_.data(), send_buffer_.size()) : -1;
+    if (send_buffer_index_ < 0) {
+      TLOG(TLVL_DEBUG) << "Couldn't register the send buffer with io_uring: " << std::strerror(errno);
+    }
+  }
+
+  void keep_unsent(size_t next)
+  {
+    std::vector<char> unsent;
+    for (; next < iov_.size(); ++next) {
+      auto bytes = static_cast<const char*>(iov_[next].iov_base);
+      unsent.insert(unsent.end(), bytes, bytes + iov_[next].iov_len);
+    }
+    unsent_ = std::move(unsent);
+  }
+
+  // Connects if not connected already, retrying until the deadline while nothing is
+  // listening. A connection still in progress at the deadline is kept for the next call
+  // -Throws TcpSocketError if no socket can be made, as retrying wouldn't help
+  Status connect(tcp::clock_type::time_point deadline)
+  {
+    while (!connected_) {
+      if (fd_ < 0) {
+        fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+          throw TcpSocketError(ERS_HERE, "Making a socket", connection_string_, std::strerror(errno));
+        }
+        // The buffer sizes have to be set before connecting for the TCP window to scale to them
+        tcp::configure(fd_, socket_buffer_size_, no_delay_);
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&address_), address_length_) == 0) { // NOLINT
+          connected();
+          break;
+        }
+        if (errno != EINPROGRESS) {
+          disconnect();
+        }
+      }
+
+      if (fd_ >= 0) {
+        auto status = tcp::wait_for(fd_, POLLOUT, deadline);
+        if (status != Status::Ok) {
+          return status;
+        }
+        int error = 0;
+        socklen_t error_length = sizeof(error);
+        getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &error_length);
+        if (error == 0) {
+          connected();
+          break;
+        }
+        disconnect();
+      }
+
+      auto now = tcp::clock_type::now();
+      if (now >= deadline) {
+        return Status::Timeout;
+      }
+      std::this_thread::sleep_for(std::min<tcp::clock_type::duration>(deadline - now, connect_retry_interval));
+    }
+    return Status::Ok;
+  }
+
+  void connected()
+  {
+    connected_ = true;
+    // io_uring waits for room in the socket itself, which it only does for blocking sockets
+    if (use_ring()) {
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_NONBLOCK);
+    }
+  }
+
+  bool use_ring() const noexcept { return ring_ && ring_->usable(); }
+
+  void disconnect()
+  {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+    connected_ = false;
+    unsent_.clear();
+  }
+
+  std::shared_ptr<IoUring> ring_;
+  std::atomic<uint64_t> operations_{ 0 };
+  std::vector<char> send_buffer_; // Registered with the ring as send_buffer_index_
+  int send_buffer_index_{ -1 };
+  std::string connection_string_;
+  sockaddr_storage address_{};
+  socklen_t address_length_{ 0 };
+  int socket_buffer_size_{ tcp::default_socket_buffer_size };
+  bool no_delay_{ true };
+  int fd_{ -1 };
+  bool connected_{ false };
+  std::vector<tcp::FrameHeader> headers_; // These and iov_ are kept between sends to save the allocations
+  std::vector<iovec> iov_;
+  std::vector<char> unsent_;
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+#endif // IPM_PLUGINS_TCPSENDERIMPL_HPP_
@@ -0,0 +1,152 @@
+/**
+ *
+ * @file TcpSocket.hpp Framing and socket routines shared by TcpSender and TcpReceiver
+ *
+ * The TCP transport sends each message as a frame: a FrameHeader giving
+ * the sizes of the topic and payload, followed by the topic and then the
+ * payload. The header is in host byte order, as the transport is meant
+ * for links between machines of the same architecture.
+ *
+ * A frame can't be abandoned partway through without leaving the stream
+ * out of step. So a sender whose deadline passes once a frame has started
+ * going out keeps the rest and writes it before its next frame, and a
+ * receiver which gives up partway through a frame carries on with it at
+ * the next call
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_TCPSOCKET_HPP_
+#define IPM_PLUGINS_TCPSOCKET_HPP_
+
+#include "ipm/Status.hpp"
+
+#include "ers/Issue.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace dunedaq {
+ERS_DECLARE_ISSUE(ipm,
+                  TcpSocketError,
+                  operation << " failed for " << connection_string << ": " << error,
+                  ((std::string)operation)((std::string)connection_string)((std::string)error))
+} // namespace dunedaq
+
+namespace dunedaq::ipm::tcp {
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr uint32_t frame_magic = 0x46504d49; // "IPMF"
+static constexpr int default_socket_buffer_size = 4 << 20;
+
+struct FrameHeader
+{
+  uint32_t magic;
+  uint32_t topic_size;
+  uint64_t payload_size;
+};
+
+inline Status
+status_for(int error_number)
+{
+  return error_number == EINTR ? Status::Interrupted : Status::Error;
+}
+
+inline clock_type::time_point
+deadline_for(std::chrono::milliseconds timeout)
+{
+  auto now = clock_type::now();
+  if (timeout == std::chrono::milliseconds::max() ||
+      timeout >= std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::time_point::max() - now)) {
+    return clock_type::time_point::max();
+  }
+  return now + timeout;
+}
+
+// The timeout in milliseconds which poll and epoll_wait take, -1 meaning "wait forever"
+inline int
+timeout_for(clock_type::time_point deadline)
+{
+  if (deadline == clock_type::time_point::max()) {
+    return -1;
+  }
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_type::now());
+  return static_cast<int>(
+    std::clamp<std::chrono::milliseconds::rep>(remaining.count(), 0, std::numeric_limits<int>::max()));
+}
+
+// Waits until the deadline for the fd to have one of the events
+inline Status
+wait_for(int fd, short events, clock_type::time_point deadline)
+{
+  pollfd item = { fd, events, 0 };
+  int rc = poll(&item, 1, timeout_for(deadline));
+  if (rc < 0) {
+    return status_for(errno);
+  }
+  return rc == 0 ? Status::Timeout : Status::Ok;
+}
+
+// Resolves "tcp://host:port", where a host of "*" means any local address
+// -Throws TcpSocketError if the address can't be resolved
+inline sockaddr_storage
+resolve(std::string const& connection_string, socklen_t& length)
+{
+  std::string address = connection_string;
+  auto scheme = address.find("://");
+  if (scheme != std::string::npos) {
+    address.erase(0, scheme + 3);
+  }
+  auto colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    throw TcpSocketError(ERS_HERE, "Parsing the address", connection_string, "no port given");
+  }
+  auto host = address.substr(0, colon);
+  auto port = address.substr(colon + 1);
+
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = host == "*" ? AI_PASSIVE : 0;
+  addrinfo* result = nullptr;
+  int rc = getaddrinfo(host == "*" ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+  if (rc != 0) {
+    throw TcpSocketError(ERS_HERE, "getaddrinfo", connection_string, gai_strerror(rc));
+  }
+  sockaddr_storage storage{};
+  std::memcpy(&storage, result->ai_addr, result->ai_addrlen);
+  length = result->ai_addrlen;
+  freeaddrinfo(result);
+  return storage;
+}
+
+// Sizes the kernel's buffers (when "buffer_size" is positive) and turns off Nagle's
+// algorithm, so that small messages aren't held back
+inline void
+configure(int fd, int buffer_size, bool no_delay)
+{
+  if (buffer_size > 0) {
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+  }
+  int flag = no_delay ? 1 : 0;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+} // namespace dunedaq::ipm::tcp
+
+#endif // IPM_PLUGINS_TCPSOCKET_HPP_
@@ -0,0 +1,31 @@
+/**
+ *
+ * @file UringReceiver.cpp UringReceiver messaging class definitions
+ *
+ * UringReceiver is the TCP Receiver (see TcpReceiverImpl.hpp) which uses
+ * io_uring, falling back to plain socket calls if the kernel doesn't support it
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "UringReceiver"
+
+#include "TcpReceiverImpl.hpp"
+
+namespace dunedaq {
+namespace ipm {
+class UringReceiver : public TcpReceiverImpl
+{
+public:
+  UringReceiver()
+    : TcpReceiverImpl(TcpReceiverImpl::Backend::Uring)
+  {}
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_RECEIVER(dunedaq::ipm::UringReceiver)
@@ -0,0 +1,31 @@
+/**
+ *
+ * @file UringSender.cpp UringSender messaging class definitions
+ *
+ * UringSender is the TCP Sender (see TcpSenderImpl.hpp) which uses
+ * io_uring, falling back to plain socket calls if the kernel doesn't support it
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "TRACE/trace.h"
+#define TRACE_NAME "UringSender"
+
+#include "TcpSenderImpl.hpp"
+
+namespace dunedaq {
+namespace ipm {
+class UringSender : public TcpSenderImpl
+{
+public:
+  UringSender()
+    : TcpSenderImpl(TcpSenderImpl::Backend::Uring)
+  {}
+};
+
+} // namespace ipm
+} // namespace dunedaq
+
+DEFINE_DUNE_IPM_SENDER(dunedaq::ipm::UringSender)
@@ -2,6 +2,20 @@
  *
  * @file ZmqReceiverImpl.hpp Implementations of common routines for ZeroMQ Receivers
  *
+ * With "busy_poll_us" set in the connection info, a receive first spins on
+ * nonblocking receives for up to that many microseconds before falling back
+ * to a blocking one, so a message arriving within that time is taken
+ * without a wakeup from the kernel. Unless "busy_poll_adaptive" is false,
+ * the spin is shortened to twice the average gap between messages, and
+ * skipped when that gap is longer than busy_poll_us, so a quiet link
+ * doesn't keep a core busy for nothing. statistics() reports how often the
+ * spin found a message ("spin_hits") or gave up ("spin_misses"), and the
+ * current spin ("spin_budget_us")
+ *
+ * Topics and payloads are handed out in the ZMQ messages they arrived in,
+ * without being copied. Only the parts of a multipart message, which have
+ * to be joined anyway, are copied into a block from the BufferPool
+ *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
  * received with this code.
@@ -11,9 +25,18 @@
 
 #include "TRACE/trace.h"
 
+#include "ZmqSocketOptions.hpp"
+
+#include "ipm/BufferPool.hpp"
 #include "ipm/Subscriber.hpp"
 #include "ipm/ZmqContext.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 #include <zmq.hpp>
@@ -35,15 +58,39 @@ public:
     : socket_(ZmqContext::instance().GetContext(), type == ReceiverType::Pull ? zmq::socket_type::pull : zmq::socket_type::sub)
   {
   }
+
   bool can_receive() const noexcept override { return socket_connected_; }
   void connect_for_receives(const nlohmann::json& connection_info) override
   {
-    std::string connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
-    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
-    socket_.connect(connection_string);
+    spin_limit_ = std::chrono::microseconds(std::max(0, connection_info.value<int>("busy_poll_us", 0)));
+    spin_adaptive_ = connection_info.value<bool>("busy_poll_adaptive", true);
+    spin_budget_ = spin_limit_;
+    spin_budget_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(spin_limit_).count());
+    mean_gap_ = spin_clock::duration::zero();
+    last_arrival_ = spin_clock::time_point();
+    ZmqContext::set_io_thread_affinity(socket_, connection_info);
+    zmq_options::apply_receive_options(socket_, connection_info);
+    for (auto const& connection_string : zmq_options::connection_strings(connection_info, "inproc://default")) {
+      TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+      socket_.connect(connection_string);
+    }
     socket_connected_ = true;
   }
 
+  PollHandle poll_handle() noexcept override
+  {
+    PollHandle handle;
+    handle.socket = static_cast<void*>(socket_);
+    return handle;
+  }
+
+  nlohmann::json statistics() const override
+  {
+    return { { "spin_hits", spin_hits_.load(std::memory_order_relaxed) },
+             { "spin_misses", spin_misses_.load(std::memory_order_relaxed) },
+             { "spin_budget_us", spin_budget_us_.load(std::memory_order_relaxed) } };
+  }
+
   void subscribe(std::string const& topic) override { socket_.setsockopt(ZMQ_SUBSCRIBE, topic.c_str(), topic.size()); }
   void unsubscribe(std::string const& topic) override
   {
@@ -53,33 +100,263 @@ public:
 protected:
   Receiver::Response receive_(const duration_type& timeout) override
   {
-    auto timeout_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
-    socket_.setsockopt(ZMQ_RCVTIMEO, timeout_in_ms);
-    Receiver::Response output;
-    zmq::message_t hdr, msg;
-    size_t res = 0;
-    try {
-      res = socket_.recv(&hdr);
-    } catch (zmq::error_t const& err) {
-      // Throw ERS-ified exception
-    }
-    if (res > 0) {
-      output.metadata.reserve(hdr.size());
-      memcpy(&output.metadata[0], hdr.data(), hdr.size());
-
-      // ZMQ guarantees that the entire message has arrived
-      socket_.recv(&msg);
-      output.data.reserve(msg.size());
-      memcpy(&output.data[0], msg.data(), msg.size());
-    } else {
-      // timeout
+    auto result = try_receive_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::Response> try_receive_(const duration_type& timeout) override
+  {
+    auto message = try_receive_buffer_(timeout);
+    Result<Receiver::Response> result;
+    result.status = message.status;
+    result->metadata.assign(message->metadata.begin(), message->metadata.end());
+    result->data.assign(message->data.begin(), message->data.end());
+    return result;
+  }
+
+  Receiver::BufferResponse receive_buffer_(const duration_type& timeout) override
+  {
+    auto result = try_receive_buffer_(timeout);
+    check_status(result.status, timeout);
+    return std::move(result.value);
+  }
+
+  Result<Receiver::BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    Result<Receiver::BufferResponse> result;
+    zmq::message_t hdr;
+    result.status = receive_first_frame(hdr, timeout);
+    if (result.status == Status::Ok) {
+      result.status = receive_payload(std::move(hdr), result.value);
+    }
+    return result;
+  }
+
+  // Only the first message waits for the timeout; the rest are taken from what
+  // ZMQ has already queued
+  size_type receive_batch_(std::vector<BufferResponse>& messages,
+                           size_type max_messages,
+                           const duration_type& timeout) override
+  {
+    while (static_cast<size_type>(messages.size()) < max_messages) {
+      zmq::message_t hdr;
+      auto status = messages.empty() ? receive_first_frame(hdr, timeout) : receive_frame(hdr, ZMQ_DONTWAIT);
+      if (status == Status::Ok) {
+        messages.emplace_back();
+        status = receive_payload(std::move(hdr), messages.back());
+        if (status != Status::Ok) {
+          messages.pop_back();
+        }
+      }
+      if (status != Status::Ok) {
+        if (messages.empty() && status != Status::Timeout) {
+          check_status(status, timeout);
+        }
+        break;
+      }
+    }
+    return static_cast<size_type>(messages.size());
+  }
+
+  // The payload frames are received straight into the caller's buffer with zmq_recv,
+  // which reports the full size of each frame even when it has to truncate it
+  Receiver::ReceiveIntoResponse receive_into_(void* buffer,
+                                              size_type capacity,
+                                              const duration_type& timeout,
+                                              std::string* metadata) override
+  {
+    Receiver::ReceiveIntoResponse output;
+    zmq::message_t hdr;
+    auto status = receive_first_frame(hdr, timeout);
+    if (status == Status::Timeout) {
+      return output;
+    }
+    check_status(status, timeout);
+
+    if (metadata) {
+      metadata->assign(hdr.data<char>(), hdr.size());
+    }
+    auto bytes = static_cast<char*>(buffer);
+    size_t received = 0;
+    do {
+      size_t offset = std::min<size_t>(received, capacity);
+      int nbytes = zmq_recv(static_cast<void*>(socket_), bytes + offset, capacity - offset, 0);
+      if (nbytes < 0) {
+        check_status(status_for(zmq_errno()), timeout);
+      }
+      received += static_cast<size_t>(nbytes);
+    } while (socket_.getsockopt<int>(ZMQ_RCVMORE));
+    output.size = static_cast<size_type>(received);
+    output.truncated = output.size > capacity;
+    return output;
+  }
+
+  Receiver::MultipartResponse receive_multipart_(const duration_type& timeout) override
+  {
+    Receiver::MultipartResponse output;
+    zmq::message_t hdr;
+    check_status(receive_first_frame(hdr, timeout), timeout);
+
+    output.metadata = to_buffer(std::move(hdr));
+    bool more = true;
+    while (more) {
+      zmq::message_t msg;
+      check_status(receive_frame(msg, 0), timeout);
+      more = msg.more();
+      output.data.push_back(to_buffer(std::move(msg)));
     }
     return output;
   }
 
 private:
+  using spin_clock = std::chrono::steady_clock;
+
+  // ZMQ_RCVTIMEO is only changed when the requested timeout differs from the last one
+  void set_receive_timeout(const duration_type& timeout)
+  {
+    // ZMQ_RCVTIMEO is an int, with -1 meaning "wait forever"
+    int timeout_in_ms = -1;
+    if (timeout != block) {
+      timeout_in_ms = static_cast<int>(
+        std::min<duration_type::rep>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count(),
+                                     std::numeric_limits<int>::max()));
+    }
+    if (timeout_in_ms != receive_timeout_in_ms_) {
+      socket_.setsockopt(ZMQ_RCVTIMEO, timeout_in_ms);
+      receive_timeout_in_ms_ = timeout_in_ms;
+    }
+  }
+
+  // Receive one frame without throwing; EAGAIN means the timeout expired
+  Status receive_frame(zmq::message_t& msg, int flags)
+  {
+    if (zmq_msg_recv(msg.handle(), static_cast<void*>(socket_), flags) < 0) {
+      return zmq_errno() == EAGAIN ? Status::Timeout : status_for(zmq_errno());
+    }
+    return Status::Ok;
+  }
+
+  // Waits up to the timeout for the topic frame which starts a message, spinning
+  // first if busy polling is on. Only the rest of the timeout is left for the blocking
+  // receive which follows a spin that found nothing
+  Status receive_first_frame(zmq::message_t& hdr, const duration_type& timeout)
+  {
+    auto spin = timeout == block ? spin_budget_ : std::min<spin_clock::duration>(spin_budget_, timeout);
+    if (spin <= spin_clock::duration::zero()) {
+      set_receive_timeout(timeout);
+      auto status = receive_frame(hdr, 0);
+      if (status == Status::Ok) {
+        arrived(spin_clock::now());
+      }
+      return status;
+    }
+
+    auto start = spin_clock::now();
+    auto now = start;
+    do {
+      auto status = receive_frame(hdr, ZMQ_DONTWAIT);
+      now = spin_clock::now();
+      if (status != Status::Timeout) {
+        if (status == Status::Ok) {
+          spin_hits_.fetch_add(1, std::memory_order_relaxed);
+          arrived(now);
+        }
+        return status;
+      }
+    } while (now - start < spin);
+    spin_misses_.fetch_add(1, std::memory_order_relaxed);
+
+    auto remaining = timeout;
+    if (timeout != block) {
+      remaining = std::max(noblock, timeout - std::chrono::ceil<duration_type>(now - start));
+    }
+    set_receive_timeout(remaining);
+    auto status = receive_frame(hdr, 0);
+    if (status == Status::Ok) {
+      arrived(spin_clock::now());
+    }
+    return status;
+  }
+
+  // Keeps a moving average of the gap between messages, and sets the spin from it
+  void arrived(spin_clock::time_point now)
+  {
+    if (spin_limit_ == spin_clock::duration::zero() || !spin_adaptive_) {
+      return;
+    }
+    if (last_arrival_ != spin_clock::time_point()) {
+      mean_gap_ += ((now - last_arrival_) - mean_gap_) / 8;
+      spin_budget_ = mean_gap_ > spin_limit_ ? spin_clock::duration::zero() : std::min(2 * mean_gap_, spin_limit_);
+      spin_budget_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(spin_budget_).count(),
+                            std::memory_order_relaxed);
+    }
+    last_arrival_ = now;
+  }
+
+  // Receive the payload which follows the topic frame
+  Status receive_payload(zmq::message_t&& hdr, Receiver::BufferResponse& output)
+  {
+    zmq::message_t msg;
+
+    // ZMQ guarantees that the entire message has arrived
+    auto status = receive_frame(msg, 0);
+    if (status != Status::Ok) {
+      return status;
+    }
+    output.metadata = to_buffer(std::move(hdr));
+    if (!msg.more()) {
+      output.data = to_buffer(std::move(msg));
+    } else {
+      auto& pool = BufferPool::instance();
+      // The parts of a multipart message have to be joined to be handed out as one
+      // buffer, which is moved to a larger block whenever the next part doesn't fit
+      auto joined = pool.allocate(msg.size());
+      std::memcpy(joined.data(), msg.data(), msg.size());
+      size_t size = msg.size();
+      while (msg.more()) {
+        status = receive_frame(msg, 0);
+        if (status != Status::Ok) {
+          return status;
+        }
+        if (size + msg.size() > joined.capacity()) {
+          auto larger = pool.allocate(std::max(size + msg.size(), 2 * joined.capacity()));
+          std::memcpy(larger.data(), joined.data(), size);
+          joined = std::move(larger);
+        }
+        std::memcpy(joined.data() + size, msg.data(), msg.size());
+        size += msg.size();
+      }
+      output.data = std::move(joined).to_message_buffer(static_cast<MessageBuffer::size_type>(size));
+    }
+    return Status::Ok;
+  }
+
+  static Status status_for(int error_number) { return error_number == EINTR ? Status::Interrupted : Status::Error; }
+
+  // Hand the zmq message itself to the MessageBuffer so the payload is never copied.
+  // The data pointer is taken after the move, as small messages are stored inline
+  static MessageBuffer to_buffer(zmq::message_t&& msg)
+  {
+    auto owner = new zmq::message_t(std::move(msg));
+    return MessageBuffer(owner->data(), static_cast<MessageBuffer::size_type>(owner->size()), owner, [](void* ptr) {
+      delete static_cast<zmq::message_t*>(ptr); // NOLINT
+    });
+  }
+
   zmq::socket_t socket_;
   bool socket_connected_{ false };
+  int receive_timeout_in_ms_{ -1 }; // The ZMQ default
+
+  // Busy polling; the counters can be read by other threads through statistics()
+  spin_clock::duration spin_limit_{ spin_clock::duration::zero() };
+  bool spin_adaptive_{ true };
+  spin_clock::duration spin_budget_{ spin_clock::duration::zero() };
+  spin_clock::duration mean_gap_{ spin_clock::duration::zero() };
+  spin_clock::time_point last_arrival_{};
+  std::atomic<uint64_t> spin_hits_{ 0 };
+  std::atomic<uint64_t> spin_misses_{ 0 };
+  std::atomic<int64_t> spin_budget_us_{ 0 };
 };
 
 } // namespace ipm
@@ -10,14 +10,31 @@
 
 #include "TRACE/trace.h"
 
+#include "ZmqSocketOptions.hpp"
+
+#include "ipm/SendQueue.hpp"
 #include "ipm/Sender.hpp"
+#include "ipm/ThreadPlacement.hpp"
 #include "ipm/ZmqContext.hpp"
 
+#include "ers/ers.h"
+
+#include <chrono>
+#include <future>
 #include <string>
+#include <vector>
 #include <zmq.hpp>
 
 namespace dunedaq {
 namespace ipm {
+
+// If "async_send" is true in the connection info, sends are put on a SendQueue of
+// "async_queue_capacity" messages and return straight away, while its owner thread,
+// the only one to use the socket, sends them. The timeout given to send() then covers
+// both the wait for room in the queue, which is all send() itself waits for, and the
+// background send. Only send_async() reports what became of the message; otherwise
+// failures are reported through ERS. The background thread is pinned to
+// "async_thread_cpus", if given
 class ZmqSenderImpl : public Sender
 {
 public:
@@ -27,45 +44,270 @@ public:
   Push,
   };
 
+  using clock_type = SendQueue::clock_type;
+
+  static constexpr size_t default_async_queue_capacity = 1024;
+
   ZmqSenderImpl(SenderType type)
     : socket_(ZmqContext::instance().GetContext(), type == SenderType::Push ? zmq::socket_type::push : zmq::socket_type::pub)
   {
   }
+
+  // The background thread uses the socket, so it has to finish before the socket goes away
+  ~ZmqSenderImpl() override { async_queue_.stop(); }
+
   bool can_send() const noexcept override { return socket_connected_; }
+
+  // In async mode the socket belongs to the background thread, so it can't be polled
+  PollHandle poll_handle() noexcept override
+  {
+    PollHandle handle;
+    if (!async_queue_.running()) {
+      handle.socket = static_cast<void*>(socket_);
+    }
+    return handle;
+  }
+  // Connecting again adds endpoints to the socket. In async mode whatever is queued is
+  // sent first, and the background thread is restarted with the new settings, so no other
+  // thread may be sending meanwhile
   void connect_for_sends(const nlohmann::json& connection_info)
   {
-    std::string connection_string = connection_info.value<std::string>("connection_string", "inproc://default");
-    TLOG(TLVL_INFO) << "Connection String is " << connection_string;
-    socket_.bind(connection_string);
+    async_queue_.stop();
+    ZmqContext::set_io_thread_affinity(socket_, connection_info);
+    zmq_options::apply_send_options(socket_, connection_info);
+    for (auto const& connection_string : zmq_options::connection_strings(connection_info, "inproc://default")) {
+      TLOG(TLVL_INFO) << "Connection String is " << connection_string;
+      socket_.bind(connection_string);
+    }
     socket_connected_ = true;
+
+    if (connection_info.value<bool>("async_send", false)) {
+      async_queue_.start(connection_info.value<size_t>("async_queue_capacity", default_async_queue_capacity),
+                         1,
+                         placement::cpus_for(connection_info, "async_thread_cpus"),
+                         [this](std::vector<SendQueue::PendingSend>& batch) { send_pending(batch); });
+    }
   }
 
 protected:
   void send_(const void* message, int N, const duration_type& timeout, std::string const& topic) override
   {
+    check_status(try_send_(message, N, timeout, topic), timeout);
+  }
+
+  Status try_send_(const void* message, int N, const duration_type& timeout, std::string const& topic) override
+  {
+    if (async_queue_.running()) {
+      auto pending = SendQueue::make_pending(timeout, topic);
+      pending.parts.push_back(SendQueue::copy(message, N));
+      return async_queue_.push(std::move(pending));
+    }
+    zmq::message_t msg(message, N);
+    return send_messages(&msg, 1, SendQueue::deadline_for(timeout), topic);
+  }
 
-    auto timeout_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+  // The caller keeps ownership of the parts, so they are copied into their frames, but
+  // they are no longer joined or sent as separate messages
+  void send_multipart_(const void** message_parts,
+                       const std::vector<size_type>& message_sizes,
+                       const duration_type& timeout,
+                       std::string const& topic) override
+  {
+    if (async_queue_.running()) {
+      auto pending = SendQueue::make_pending(timeout, topic);
+      for (size_t i = 0; i < message_sizes.size(); ++i) {
+        pending.parts.push_back(SendQueue::copy(message_parts[i], message_sizes[i]));
+      }
+      check_status(async_queue_.push(std::move(pending)), timeout);
+      return;
+    }
 
-    // The "2" is because there are two 0MQ sends in this
-    // function. Hopefully most timeouts are even, and more than
-    // several milliseconds...
+    std::vector<zmq::message_t> msgs;
+    msgs.reserve(message_sizes.size());
+    for (size_t i = 0; i < message_sizes.size(); ++i) {
+      msgs.emplace_back(message_parts[i], message_sizes[i]);
+    }
+    check_status(send_messages(msgs.data(), msgs.size(), SendQueue::deadline_for(timeout), topic), timeout);
+  }
+
+  // The whole batch shares one deadline, and the frames are sent straight from the
+  // callers' buffers with zmq_send rather than being wrapped in zmq::message_ts
+  void send_batch_(const std::vector<BatchEntry>& messages, const duration_type& timeout) override
+  {
+    auto deadline = SendQueue::deadline_for(timeout);
+    for (auto const& entry : messages) {
+      if (entry.size == 0) {
+        continue;
+      }
+      if (async_queue_.running()) {
+        auto pending = SendQueue::make_pending(timeout, std::string(entry.metadata));
+        pending.parts.push_back(SendQueue::copy(entry.message, entry.size));
+        pending.deadline = deadline;
+        check_status(async_queue_.push(std::move(pending)), timeout);
+        continue;
+      }
+      auto status = send_frame(entry.metadata.data(), entry.metadata.size(), ZMQ_SNDMORE, deadline);
+      if (status == Status::Ok) {
+        status = send_frame(entry.message, entry.size, 0, deadline);
+      }
+      check_status(status, timeout);
+    }
+  }
 
-    timeout_in_ms /= 2;  
+  void send_buffer_(MessageBuffer message, const duration_type& timeout, std::string const& topic) override
+  {
+    if (async_queue_.running()) {
+      auto pending = SendQueue::make_pending(timeout, topic);
+      pending.parts.push_back(std::move(message));
+      check_status(async_queue_.push(std::move(pending)), timeout);
+      return;
+    }
+    auto msg = to_message(std::move(message));
+    check_status(send_messages(&msg, 1, SendQueue::deadline_for(timeout), topic), timeout);
+  }
 
-    socket_.setsockopt(ZMQ_SNDTIMEO, timeout_in_ms ); 
+  void send_buffer_multipart_(std::vector<MessageBuffer> message_parts,
+                              const duration_type& timeout,
+                              std::string const& topic) override
+  {
+    if (async_queue_.running()) {
+      auto pending = SendQueue::make_pending(timeout, topic);
+      pending.parts = std::move(message_parts);
+      check_status(async_queue_.push(std::move(pending)), timeout);
+      return;
+    }
+    check_status(send_buffers(message_parts, SendQueue::deadline_for(timeout), topic), timeout);
+  }
 
-    zmq::message_t topic_msg(topic.c_str(), topic.size());
-    socket_.send(topic_msg, ZMQ_SNDMORE);
+  std::future<Status> send_async_(MessageBuffer message,
+                                  const duration_type& timeout,
+                                  std::string const& topic) override
+  {
+    if (!async_queue_.running()) {
+      return Sender::send_async_(std::move(message), timeout, topic);
+    }
 
-    zmq::message_t msg(message, N);
-    socket_.send(msg);
+    auto pending = SendQueue::make_pending(timeout, topic);
+    pending.parts.push_back(std::move(message));
+    return async_queue_.push_async(std::move(pending));
   }
 
 private:
+  // Runs on the SendQueue's owner thread, one message at a time
+  void send_pending(std::vector<SendQueue::PendingSend>& batch)
+  {
+    for (auto& pending : batch) {
+      // Once stopping, whatever is still queued gets a single attempt
+      auto deadline = async_queue_.stopping() ? clock_type::now() : pending.deadline;
+      auto status = send_buffers(pending.parts, deadline, pending.topic);
+      if (pending.promise) {
+        pending.promise->set_value(status);
+      } else if (status != Status::Ok) {
+        ers::warning(SendFailed(ERS_HERE, to_string(status)));
+      }
+    }
+  }
+
+  Status send_buffers(std::vector<MessageBuffer>& parts, clock_type::time_point deadline, std::string const& topic)
+  {
+    if (parts.size() == 1) {
+      auto msg = to_message(std::move(parts.front()));
+      return send_messages(&msg, 1, deadline, topic);
+    }
+
+    std::vector<zmq::message_t> msgs;
+    msgs.reserve(parts.size());
+    for (auto& part : parts) {
+      msgs.push_back(to_message(std::move(part)));
+    }
+    return send_messages(msgs.data(), msgs.size(), deadline, topic);
+  }
+
+  // Send the topic frame followed by the given frames as a single ZMQ multipart message,
+  // all against the same deadline
+  Status send_messages(zmq::message_t* msgs, size_t count, clock_type::time_point deadline, std::string const& topic)
+  {
+    auto status = send_frame(topic.c_str(), topic.size(), ZMQ_SNDMORE, deadline);
+
+    for (size_t i = 0; i < count && status == Status::Ok; ++i) {
+      status = send_frame(msgs[i], i + 1 < count ? ZMQ_SNDMORE : 0, deadline);
+    }
+    return status;
+  }
+
+  // Frames are sent without blocking; if ZMQ can't take one yet, wait for the socket
+  // to become writable until the deadline passes. Once ZMQ has accepted the first
+  // frame of a message it accepts the rest, so a timeout never leaves a partial message.
+  // None of this throws, so that try_send_ reports a timeout at the cost of a return
+  Status send_frame(const void* data, size_t size, int flags, clock_type::time_point deadline)
+  {
+    while (zmq_send(static_cast<void*>(socket_), data, size, flags | ZMQ_DONTWAIT) < 0) {
+      if (zmq_errno() != EAGAIN) {
+        return status_for(zmq_errno());
+      }
+      auto status = wait_for_send(deadline);
+      if (status != Status::Ok) {
+        return status;
+      }
+    }
+    return Status::Ok;
+  }
+
+  Status send_frame(zmq::message_t& msg, int flags, clock_type::time_point deadline)
+  {
+    while (zmq_msg_send(msg.handle(), static_cast<void*>(socket_), flags | ZMQ_DONTWAIT) < 0) {
+      if (zmq_errno() != EAGAIN) {
+        return status_for(zmq_errno());
+      }
+      auto status = wait_for_send(deadline);
+      if (status != Status::Ok) {
+        return status;
+      }
+    }
+    return Status::Ok;
+  }
+
+  // Returns Status::Timeout if the deadline passes before the socket is writable
+  Status wait_for_send(clock_type::time_point deadline)
+  {
+    long poll_timeout_ms = -1; // Wait forever
+    if (deadline != clock_type::time_point::max()) {
+      auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_type::now());
+      if (remaining.count() <= 0) {
+        return Status::Timeout;
+      }
+      poll_timeout_ms = remaining.count();
+    }
+
+    zmq_pollitem_t item = { static_cast<void*>(socket_), 0, ZMQ_POLLOUT, 0 };
+    if (zmq_poll(&item, 1, poll_timeout_ms) < 0) {
+      return status_for(zmq_errno());
+    }
+    return Status::Ok;
+  }
+
+  static Status status_for(int error_number) { return error_number == EINTR ? Status::Interrupted : Status::Error; }
+
+  // ZMQ calls release_buffer once it is done with the payload, possibly from its I/O
+  // thread, so the MessageBuffer is kept alive on the heap until then
+  static zmq::message_t to_message(MessageBuffer&& message)
+  {
+    auto data = const_cast<char*>(message.data()); // NOLINT
+    auto size = static_cast<size_t>(message.size());
+    auto owner = new MessageBuffer(std::move(message));
+    return zmq::message_t(data, size, &release_buffer, owner);
+  }
+
+  static void release_buffer(void* /* data */, void* hint) { delete static_cast<MessageBuffer*>(hint); } // NOLINT
+
   zmq::socket_t socket_;
-  bool socket_connected_;
+  bool socket_connected_{ false };
+
+  // Only running in async mode
+  SendQueue async_queue_;
 };
 
 
 } // namespace ipm
 } // namespace dunedaq
+
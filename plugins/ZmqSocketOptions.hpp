@@ -0,0 +1,108 @@
+/**
+ *
+ * @file ZmqSocketOptions.hpp Connection options shared by the ZMQ Senders and Receivers
+ *
+ * Socket tuning options are given in the connection info under the
+ * lower-case names of the ZMQ options they set, e.g. "sndhwm" for
+ * ZMQ_SNDHWM. Only those present are set, and the rest keep ZMQ's
+ * defaults. They have to be applied before the socket is bound or
+ * connected.
+ *
+ * "out_batch_size" and "in_batch_size" are only available when libzmq is
+ * built with its draft API, and are ignored otherwise. "conflate" keeps
+ * only the last message, and doesn't work with the multipart messages
+ * which send_multipart() and topics produce
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef IPM_PLUGINS_ZMQSOCKETOPTIONS_HPP_
+#define IPM_PLUGINS_ZMQSOCKETOPTIONS_HPP_
+
+#include "nlohmann/json.hpp"
+
+#include <zmq.hpp>
+
+#include <string>
+#include <vector>
+
+namespace dunedaq::ipm::zmq_options {
+
+// "connection_string" may be a single endpoint or a list of them, e.g.
+// ["ipc:///tmp/fragments", "tcp://*:5600"], which a Sender binds and a Receiver
+// connects to all of. A Receiver takes messages from its endpoints in turn
+inline std::vector<std::string>
+connection_strings(const nlohmann::json& connection_info, std::string const& default_connection_string)
+{
+  if (connection_info.contains("connection_string") && connection_info.at("connection_string").is_array()) {
+    return connection_info.at("connection_string").get<std::vector<std::string>>();
+  }
+  return { connection_info.value<std::string>("connection_string", default_connection_string) };
+}
+
+struct Option
+{
+  const char* name;
+  int option;
+};
+
+// Options which apply to both directions
+static constexpr Option common_options[] = {
+  { "tcp_keepalive", ZMQ_TCP_KEEPALIVE },
+  { "tcp_keepalive_idle", ZMQ_TCP_KEEPALIVE_IDLE },
+  { "tcp_keepalive_cnt", ZMQ_TCP_KEEPALIVE_CNT },
+  { "tcp_keepalive_intvl", ZMQ_TCP_KEEPALIVE_INTVL },
+  { "immediate", ZMQ_IMMEDIATE },
+  { "linger", ZMQ_LINGER },
+  { "conflate", ZMQ_CONFLATE },
+};
+
+static constexpr Option send_options[] = {
+  { "sndhwm", ZMQ_SNDHWM },
+  { "sndbuf", ZMQ_SNDBUF },
+#ifdef ZMQ_OUT_BATCH_SIZE
+  { "out_batch_size", ZMQ_OUT_BATCH_SIZE },
+#endif
+};
+
+static constexpr Option receive_options[] = {
+  { "rcvhwm", ZMQ_RCVHWM },
+  { "rcvbuf", ZMQ_RCVBUF },
+#ifdef ZMQ_IN_BATCH_SIZE
+  { "in_batch_size", ZMQ_IN_BATCH_SIZE },
+#endif
+};
+
+// All these options are ints, with flags such as "immediate" given as true or false
+template<size_t N>
+inline void
+apply(zmq::socket_t& socket, const nlohmann::json& connection_info, const Option (&options)[N])
+{
+  for (auto const& option : options) {
+    if (connection_info.contains(option.name)) {
+      auto const& value = connection_info.at(option.name);
+      socket.setsockopt<int>(option.option, value.is_boolean() ? value.get<bool>() : value.get<int>());
+    }
+  }
+}
+
+// -Throws zmq::error_t if ZMQ rejects a value
+inline void
+apply_send_options(zmq::socket_t& socket, const nlohmann::json& connection_info)
+{
+  apply(socket, connection_info, common_options);
+  apply(socket, connection_info, send_options);
+}
+
+// -Throws zmq::error_t if ZMQ rejects a value
+inline void
+apply_receive_options(zmq::socket_t& socket, const nlohmann::json& connection_info)
+{
+  apply(socket, connection_info, common_options);
+  apply(socket, connection_info, receive_options);
+}
+
+} // namespace dunedaq::ipm::zmq_options
+
+#endif // IPM_PLUGINS_ZMQSOCKETOPTIONS_HPP_
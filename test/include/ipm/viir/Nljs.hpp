@@ -22,6 +22,18 @@ namespace dunedaq::ipm::viir {
     inline void to_json(data_t& j, const Conf& obj) {
         j["nIntsPerVector"] = obj.nIntsPerVector;
         j["queue_timeout_ms"] = obj.queue_timeout_ms;
+        j["nWorkers"] = obj.nWorkers;
+        j["io_thread_cpus"] = obj.io_thread_cpus;
+        j["rcvhwm"] = obj.rcvhwm;
+        j["rcvbuf"] = obj.rcvbuf;
+        j["tcp_keepalive"] = obj.tcp_keepalive;
+        j["tcp_keepalive_idle"] = obj.tcp_keepalive_idle;
+        j["tcp_keepalive_cnt"] = obj.tcp_keepalive_cnt;
+        j["tcp_keepalive_intvl"] = obj.tcp_keepalive_intvl;
+        j["immediate"] = obj.immediate;
+        j["linger"] = obj.linger;
+        j["conflate"] = obj.conflate;
+        j["in_batch_size"] = obj.in_batch_size;
     }
     
     inline void from_json(const data_t& j, Conf& obj) {
@@ -29,6 +41,30 @@ namespace dunedaq::ipm::viir {
             j.at("nIntsPerVector").get_to(obj.nIntsPerVector);    
         if (j.contains("queue_timeout_ms"))
             j.at("queue_timeout_ms").get_to(obj.queue_timeout_ms);    
+        if (j.contains("nWorkers"))
+            j.at("nWorkers").get_to(obj.nWorkers);    
+        if (j.contains("io_thread_cpus"))
+            j.at("io_thread_cpus").get_to(obj.io_thread_cpus);    
+        if (j.contains("rcvhwm"))
+            j.at("rcvhwm").get_to(obj.rcvhwm);    
+        if (j.contains("rcvbuf"))
+            j.at("rcvbuf").get_to(obj.rcvbuf);    
+        if (j.contains("tcp_keepalive"))
+            j.at("tcp_keepalive").get_to(obj.tcp_keepalive);    
+        if (j.contains("tcp_keepalive_idle"))
+            j.at("tcp_keepalive_idle").get_to(obj.tcp_keepalive_idle);    
+        if (j.contains("tcp_keepalive_cnt"))
+            j.at("tcp_keepalive_cnt").get_to(obj.tcp_keepalive_cnt);    
+        if (j.contains("tcp_keepalive_intvl"))
+            j.at("tcp_keepalive_intvl").get_to(obj.tcp_keepalive_intvl);    
+        if (j.contains("immediate"))
+            j.at("immediate").get_to(obj.immediate);    
+        if (j.contains("linger"))
+            j.at("linger").get_to(obj.linger);    
+        if (j.contains("conflate"))
+            j.at("conflate").get_to(obj.conflate);    
+        if (j.contains("in_batch_size"))
+            j.at("in_batch_size").get_to(obj.in_batch_size);    
     }
     
     // fixme: add support for MessagePack serializers (at least)
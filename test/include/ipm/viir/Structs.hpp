@@ -9,6 +9,8 @@
 
 #include <cstdint>
 
+#include <vector>
+
 
 namespace dunedaq::ipm::viir {
 
@@ -18,6 +20,12 @@ namespace dunedaq::ipm::viir {
     // @brief Same as an int in gcc v8.2.0
     using Int = int32_t;
 
+    // @brief A ZMQ socket option which is on or off
+    using Flag = bool;
+
+    // @brief CPUs to pin a thread to, or none to leave it unpinned
+    using CPUs = std::vector<dunedaq::ipm::viir::Int>;
+
     // @brief VectorIntIPMReceiverDAQModule Configuration
     struct Conf {
 
@@ -26,6 +34,42 @@ namespace dunedaq::ipm::viir {
 
         // @brief Milliseconds to wait on queue before timing out
         Int queue_timeout_ms;
+
+        // @brief Number of receivers, each with its own socket and thread, sharing the input
+        Size_t nWorkers;
+
+        // @brief CPUs for the receiving threads, which also hold their receive buffers on their NUMA node
+        CPUs io_thread_cpus;
+
+        // @brief ZMQ_RCVHWM: the most messages queued for receiving
+        Int rcvhwm;
+
+        // @brief ZMQ_RCVBUF: kernel receive buffer size in bytes, -1 for the OS default
+        Int rcvbuf;
+
+        // @brief ZMQ_TCP_KEEPALIVE: 1 to turn TCP keepalive on, 0 off, -1 for the OS default
+        Int tcp_keepalive;
+
+        // @brief ZMQ_TCP_KEEPALIVE_IDLE: seconds idle before the first keepalive, -1 for the OS default
+        Int tcp_keepalive_idle;
+
+        // @brief ZMQ_TCP_KEEPALIVE_CNT: unanswered keepalives before the connection drops, -1 for the OS default
+        Int tcp_keepalive_cnt;
+
+        // @brief ZMQ_TCP_KEEPALIVE_INTVL: seconds between keepalives, -1 for the OS default
+        Int tcp_keepalive_intvl;
+
+        // @brief ZMQ_IMMEDIATE: only queue messages to completed connections
+        Flag immediate;
+
+        // @brief ZMQ_LINGER: milliseconds to keep unsent messages after closing, -1 for ever
+        Int linger;
+
+        // @brief ZMQ_CONFLATE: keep only the last message; not for multipart messages
+        Flag conflate;
+
+        // @brief ZMQ_IN_BATCH_SIZE: bytes received per batch by the I/O thread
+        Int in_batch_size;
     };
 
 } // namespace dunedaq::ipm::viir
@@ -22,6 +22,19 @@ namespace dunedaq::ipm::viis {
     inline void to_json(data_t& j, const Conf& obj) {
         j["nIntsPerVector"] = obj.nIntsPerVector;
         j["queue_timeout_ms"] = obj.queue_timeout_ms;
+        j["thread_cpus"] = obj.thread_cpus;
+        j["async_send"] = obj.async_send;
+        j["async_thread_cpus"] = obj.async_thread_cpus;
+        j["sndhwm"] = obj.sndhwm;
+        j["sndbuf"] = obj.sndbuf;
+        j["tcp_keepalive"] = obj.tcp_keepalive;
+        j["tcp_keepalive_idle"] = obj.tcp_keepalive_idle;
+        j["tcp_keepalive_cnt"] = obj.tcp_keepalive_cnt;
+        j["tcp_keepalive_intvl"] = obj.tcp_keepalive_intvl;
+        j["immediate"] = obj.immediate;
+        j["linger"] = obj.linger;
+        j["conflate"] = obj.conflate;
+        j["out_batch_size"] = obj.out_batch_size;
     }
     
     inline void from_json(const data_t& j, Conf& obj) {
@@ -29,6 +42,32 @@ namespace dunedaq::ipm::viis {
             j.at("nIntsPerVector").get_to(obj.nIntsPerVector);    
         if (j.contains("queue_timeout_ms"))
             j.at("queue_timeout_ms").get_to(obj.queue_timeout_ms);    
+        if (j.contains("thread_cpus"))
+            j.at("thread_cpus").get_to(obj.thread_cpus);    
+        if (j.contains("async_send"))
+            j.at("async_send").get_to(obj.async_send);    
+        if (j.contains("async_thread_cpus"))
+            j.at("async_thread_cpus").get_to(obj.async_thread_cpus);    
+        if (j.contains("sndhwm"))
+            j.at("sndhwm").get_to(obj.sndhwm);    
+        if (j.contains("sndbuf"))
+            j.at("sndbuf").get_to(obj.sndbuf);    
+        if (j.contains("tcp_keepalive"))
+            j.at("tcp_keepalive").get_to(obj.tcp_keepalive);    
+        if (j.contains("tcp_keepalive_idle"))
+            j.at("tcp_keepalive_idle").get_to(obj.tcp_keepalive_idle);    
+        if (j.contains("tcp_keepalive_cnt"))
+            j.at("tcp_keepalive_cnt").get_to(obj.tcp_keepalive_cnt);    
+        if (j.contains("tcp_keepalive_intvl"))
+            j.at("tcp_keepalive_intvl").get_to(obj.tcp_keepalive_intvl);    
+        if (j.contains("immediate"))
+            j.at("immediate").get_to(obj.immediate);    
+        if (j.contains("linger"))
+            j.at("linger").get_to(obj.linger);    
+        if (j.contains("conflate"))
+            j.at("conflate").get_to(obj.conflate);    
+        if (j.contains("out_batch_size"))
+            j.at("out_batch_size").get_to(obj.out_batch_size);    
     }
     
     // fixme: add support for MessagePack serializers (at least)
@@ -9,6 +9,8 @@
 
 #include <cstdint>
 
+#include <vector>
+
 
 namespace dunedaq::ipm::viis {
 
@@ -18,6 +20,12 @@ namespace dunedaq::ipm::viis {
     // @brief Same as an int in gcc v8.2.0
     using Int = int32_t;
 
+    // @brief A ZMQ socket option which is on or off
+    using Flag = bool;
+
+    // @brief CPUs to pin a thread to, or none to leave it unpinned
+    using CPUs = std::vector<dunedaq::ipm::viis::Int>;
+
     // @brief VectorIntIPMSenderDAQModule Configuration
     struct Conf {
 
@@ -26,6 +34,45 @@ namespace dunedaq::ipm::viis {
 
         // @brief Milliseconds to wait on queue before timing out
         Int queue_timeout_ms;
+
+        // @brief CPUs for the thread which takes vectors from the queue and sends them
+        CPUs thread_cpus;
+
+        // @brief Have ZmqSender queue messages for a background thread to send
+        Flag async_send;
+
+        // @brief CPUs for ZmqSender's background thread, when async_send is on
+        CPUs async_thread_cpus;
+
+        // @brief ZMQ_SNDHWM: the most messages queued for sending
+        Int sndhwm;
+
+        // @brief ZMQ_SNDBUF: kernel send buffer size in bytes, -1 for the OS default
+        Int sndbuf;
+
+        // @brief ZMQ_TCP_KEEPALIVE: 1 to turn TCP keepalive on, 0 off, -1 for the OS default
+        Int tcp_keepalive;
+
+        // @brief ZMQ_TCP_KEEPALIVE_IDLE: seconds idle before the first keepalive, -1 for the OS default
+        Int tcp_keepalive_idle;
+
+        // @brief ZMQ_TCP_KEEPALIVE_CNT: unanswered keepalives before the connection drops, -1 for the OS default
+        Int tcp_keepalive_cnt;
+
+        // @brief ZMQ_TCP_KEEPALIVE_INTVL: seconds between keepalives, -1 for the OS default
+        Int tcp_keepalive_intvl;
+
+        // @brief ZMQ_IMMEDIATE: only queue messages to completed connections
+        Flag immediate;
+
+        // @brief ZMQ_LINGER: milliseconds to keep unsent messages after closing, -1 for ever
+        Int linger;
+
+        // @brief ZMQ_CONFLATE: keep only the last message; not for multipart messages
+        Flag conflate;
+
+        // @brief ZMQ_OUT_BATCH_SIZE: bytes sent per batch by the I/O thread
+        Int out_batch_size;
     };
 
 } // namespace dunedaq::ipm::viis
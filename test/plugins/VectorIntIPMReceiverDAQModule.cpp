@@ -10,9 +10,13 @@
 #include "VectorIntIPMReceiverDAQModule.hpp"
 
 #include "appfwk/cmd/Nljs.hpp"
+#include "ipm/ThreadPlacement.hpp"
+#include "ipm/ZmqContext.hpp"
 #include "ipm/viir/Nljs.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <string>
 #include <thread>
 #include <utility>
@@ -29,7 +33,6 @@ namespace ipm {
 
 VectorIntIPMReceiverDAQModule::VectorIntIPMReceiverDAQModule(const std::string& name)
   : appfwk::DAQModule(name)
-  , thread_(std::bind(&VectorIntIPMReceiverDAQModule::do_work, this, std::placeholders::_1))
   , outputQueue_(nullptr)
 {
 
@@ -56,7 +59,10 @@ VectorIntIPMReceiverDAQModule::init(const data_t& init_data)
     }
   }
   
-  input_ = makeIPMReceiver(receiver_type);
+  receiver_type_ = receiver_type;
+  ZmqContext::configure_from_init(init_data);
+  inputs_.clear();
+  inputs_.push_back(makeIPMReceiver(receiver_type_));
 
   // TODO: John Freeman (jcfree@fnal.gov), Oct-22-2020
   // In the next week, determine what to do if receiver_type isn't known
@@ -70,38 +76,72 @@ VectorIntIPMReceiverDAQModule::do_configure(const data_t& config_data)
   nIntsPerVector_ = cfg_.nIntsPerVector;
   queueTimeout_ = static_cast<std::chrono::milliseconds>(cfg_.queue_timeout_ms);
 
-  input_->connect_for_receives(cfg_);
+  // The first worker's Receiver was made in init, so that an unknown receiver_type is
+  // found out early
+  inputs_.resize(1);
+  for (size_t worker = 1; worker < std::max<size_t>(1, cfg_.nWorkers); ++worker) {
+    inputs_.push_back(makeIPMReceiver(receiver_type_));
+  }
+  threads_.clear();
+  for (auto& input : inputs_) {
+    input->connect_for_receives(config_data);
+    threads_.push_back(std::make_unique<appfwk::ThreadHelper>(
+      [this, input](std::atomic<bool>& running_flag) { do_work(running_flag, *input); }));
+  }
+  TLOG(TLVL_DEBUG) << get_name() << ": Receiving with " << inputs_.size() << " worker(s)";
 }
 
 void
 VectorIntIPMReceiverDAQModule::do_start(const data_t& /*args*/)
 {
-  thread_.start_working_thread();
+  counter_ = 0;
+  for (auto& thread : threads_) {
+    thread->start_working_thread();
+  }
 }
 
 void
 VectorIntIPMReceiverDAQModule::do_stop(const data_t& /*args*/)
 {
-  thread_.stop_working_thread();
+  for (auto& thread : threads_) {
+    thread->stop_working_thread();
+  }
 }
 
 void
-VectorIntIPMReceiverDAQModule::do_work(std::atomic<bool>& running_flag)
+VectorIntIPMReceiverDAQModule::do_work(std::atomic<bool>& running_flag, Receiver& input)
 {
-  size_t counter = 0;
+  if (!cfg_.io_thread_cpus.empty()) {
+    placement::pin_this_thread(cfg_.io_thread_cpus);
+    input.move_buffers_to_local_node();
+  }
+
   std::ostringstream oss;
+  std::vector<int> output;
 
   while (running_flag.load()) {
-    if (input_->can_receive()) {
-
-      TLOG(TLVL_TRACE) << get_name() << ": Creating output vector";
-      std::vector<int> output(nIntsPerVector_);
+    if (input.can_receive()) {
+
+      // The output queue takes ownership of each vector it is given, and its consumer
+      // doesn't hand them back, so every message pushed costs one allocation here.
+      // Timeouts and size mismatches reuse the vector, and nothing else allocates
+      if (output.size() != nIntsPerVector_) {
+        TLOG(TLVL_TRACE) << get_name() << ": Creating output vector";
+        output.resize(nIntsPerVector_);
+      }
 
-      auto recvd = input_->receive(queueTimeout_);
-      assert(recvd.data.size() == nIntsPerVector_ * sizeof(int));
-      memcpy(&output[0], &recvd.data[0], sizeof(int) * nIntsPerVector_);
+      // Receive straight into the vector which gets pushed downstream
+      auto expected_size = static_cast<Receiver::size_type>(sizeof(int) * nIntsPerVector_);
+      auto recvd = input.receive_into(output.data(), expected_size, queueTimeout_);
+      if (recvd.size == 0) {
+        continue;
+      }
+      if (recvd.size != expected_size) {
+        ers::warning(UnexpectedNumberOfBytes(ERS_HERE, recvd.size, expected_size));
+        continue;
+      }
 
-      oss << ": Received vector " << counter << " with size " << output.size();
+      oss << ": Received vector " << counter_++ << " with size " << output.size();
       ers::info(ReceiverProgressUpdate(ERS_HERE, get_name(), oss.str()));
       oss.str("");
 
@@ -113,7 +153,6 @@ VectorIntIPMReceiverDAQModule::do_work(std::atomic<bool>& running_flag)
       }
 
       TLOG(TLVL_TRACE) << get_name() << ": End of do_work loop";
-      counter++;
     } else {
       std::this_thread::sleep_for(std::chrono::seconds(1));
     }
@@ -3,6 +3,13 @@
  *
  * VectorIntIPMReceiverDAQModule receives vectors of integers from VectorIntIPMSenderDAQModule
  *
+ * With nWorkers greater than one, each worker has a Receiver of its own,
+ * connected with the same connection info, and so its own socket and I/O
+ * thread. With ZmqReceiver, the sender's PUSH socket deals messages out
+ * between their PULL sockets, and whichever worker is free takes the next
+ * one. The workers share the output queue, which therefore has to be one
+ * that several threads can push to, such as StdDeQueue or FollyMPMCQueue
+ *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
  * received with this code.
@@ -18,6 +25,7 @@
 
 #include "ipm/viir/Structs.hpp"
 
+#include <atomic>
 #include <future>
 #include <memory>
 #include <string>
@@ -55,13 +63,15 @@ private:
   void do_start(const data_t& );
   void do_stop(const data_t& );
 
-  // Threading
-  appfwk::ThreadHelper thread_;
-  void do_work(std::atomic<bool>& running_flag);
+  // Threading: each worker receives from its own input on its own thread
+  std::vector<std::unique_ptr<appfwk::ThreadHelper>> threads_;
+  void do_work(std::atomic<bool>& running_flag, Receiver& input);
+  std::atomic<size_t> counter_{ 0 };
 
   // Configuration
   viir::Conf cfg_;
-  std::shared_ptr<Receiver> input_;
+  std::string receiver_type_;
+  std::vector<std::shared_ptr<Receiver>> inputs_; // One per worker
   std::unique_ptr<appfwk::DAQSink<std::vector<int>>> outputQueue_;
   std::chrono::milliseconds queueTimeout_;
   size_t nIntsPerVector_ = 999;
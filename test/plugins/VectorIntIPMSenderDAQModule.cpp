@@ -10,6 +10,8 @@
 #include "VectorIntIPMSenderDAQModule.hpp"
 
 #include "appfwk/cmd/Nljs.hpp"
+#include "ipm/ThreadPlacement.hpp"
+#include "ipm/ZmqContext.hpp"
 #include "ipm/viis/Nljs.hpp"
 
 #include "TRACE/trace.h"
@@ -57,6 +59,7 @@ VectorIntIPMSenderDAQModule::init(const data_t& init_data)
     }
   }
 
+  ZmqContext::configure_from_init(init_data);
   output_ = makeIPMSender(sender_type);
 
   // TODO: John Freeman (jcfree@fnal.gov), Oct-22-2020
@@ -89,6 +92,8 @@ VectorIntIPMSenderDAQModule::do_stop(const data_t& /*args*/)
 void
 VectorIntIPMSenderDAQModule::do_work(std::atomic<bool>& running_flag)
 {
+  placement::pin_this_thread(cfg_.thread_cpus);
+
   int counter = 0;
   std::vector<int> vec;
   std::ostringstream oss;
@@ -105,7 +110,12 @@ VectorIntIPMSenderDAQModule::do_work(std::atomic<bool>& running_flag)
       }
 
       TLOG(TLVL_TRACE) << get_name() << ": Received vector of size " << vec.size() << " from queue, sending";
-      output_->send(&vec[0], vec.size() * sizeof(int), queueTimeout_);
+      try {
+        output_->send(&vec[0], vec.size() * sizeof(int), queueTimeout_);
+      } catch (const SendTimeoutExpired& excpt) {
+        ers::warning(excpt);
+        continue;
+      }
 
       counter++;
       oss << ": Sent " << counter << " vectors";
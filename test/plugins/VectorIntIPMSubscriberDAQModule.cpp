@@ -10,6 +10,8 @@
 #include "VectorIntIPMSubscriberDAQModule.hpp"
 
 #include "appfwk/cmd/Nljs.hpp"
+#include "ipm/ThreadPlacement.hpp"
+#include "ipm/ZmqContext.hpp"
 #include "ipm/viir/Nljs.hpp"
 
 #include <chrono>
@@ -61,6 +63,7 @@ VectorIntIPMSubscriberDAQModule::init(const data_t& init_data)
     }
   }
   
+  ZmqContext::configure_from_init(init_data);
   input_ = makeIPMSubscriber(Subscriber_type);
   input_->subscribe(topic);
 
@@ -76,7 +79,7 @@ VectorIntIPMSubscriberDAQModule::do_configure(const data_t& config_data)
   nIntsPerVector_ = cfg_.nIntsPerVector;
   queueTimeout_ = static_cast<std::chrono::milliseconds>(cfg_.queue_timeout_ms);
 
-  input_->connect_for_receives(cfg_);
+  input_->connect_for_receives(config_data);
 }
 
 void
@@ -94,20 +97,39 @@ VectorIntIPMSubscriberDAQModule::do_stop(const data_t& /*args*/)
 void
 VectorIntIPMSubscriberDAQModule::do_work(std::atomic<bool>& running_flag)
 {
+  if (!cfg_.io_thread_cpus.empty()) {
+    placement::pin_this_thread(cfg_.io_thread_cpus);
+    input_->move_buffers_to_local_node();
+  }
+
   size_t counter = 0;
   std::ostringstream oss;
+  std::vector<int> output;
+  std::string topic;
 
   while (running_flag.load()) {
     if (input_->can_receive()) {
 
-      TLOG(TLVL_TRACE) << get_name() << ": Creating output vector";
-      std::vector<int> output(nIntsPerVector_);
+      // The output queue takes ownership of each vector it is given, and its consumer
+      // doesn't hand them back, so every message pushed costs one allocation here.
+      // Timeouts and size mismatches reuse the vector, and nothing else allocates
+      if (output.size() != nIntsPerVector_) {
+        TLOG(TLVL_TRACE) << get_name() << ": Creating output vector";
+        output.resize(nIntsPerVector_);
+      }
 
-      auto recvd = input_->receive(queueTimeout_);
-      assert(recvd.data.size() == nIntsPerVector_ * sizeof(int));
-      memcpy(&output[0], &recvd.data[0], sizeof(int) * nIntsPerVector_);
+      // Receive straight into the vector which gets pushed downstream
+      auto expected_size = static_cast<Receiver::size_type>(sizeof(int) * nIntsPerVector_);
+      auto recvd = input_->receive_into(output.data(), expected_size, queueTimeout_, &topic);
+      if (recvd.size == 0) {
+        continue;
+      }
+      if (recvd.size != expected_size) {
+        ers::warning(UnexpectedNumberOfBytes(ERS_HERE, recvd.size, expected_size));
+        continue;
+      }
 
-      oss << ": Received vector " << counter << " with size " << output.size() << " on topic " << recvd.metadata;
+      oss << ": Received vector " << counter << " with size " << output.size() << " on topic " << topic;
       ers::info(SubscriberProgressUpdate(ERS_HERE, get_name(), oss.str()));
       oss.str("");
 
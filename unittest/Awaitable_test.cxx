@@ -0,0 +1,204 @@
+/**
+ * @file Awaitable_test.cxx Coroutine awaitable Unit Tests, built as C++20
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Awaitable.hpp"
+
+#ifndef IPM_HAVE_COROUTINES
+#error "Awaitable_test has to be built with coroutine support"
+#endif
+
+#define BOOST_TEST_MODULE Awaitable_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(Awaitable_test)
+
+namespace {
+
+// Ints through a non-blocking pipe, whose ends can be waited on by the Reactor
+class PipeReceiver : public Receiver
+{
+public:
+  explicit PipeReceiver(int fd)
+    : fd_(fd)
+  {}
+
+  void connect_for_receives(const nlohmann::json& /* connection_info */) override {}
+  bool can_receive() const noexcept override { return true; }
+  PollHandle poll_handle() noexcept override
+  {
+    PollHandle handle;
+    handle.fd = fd_;
+    return handle;
+  }
+
+protected:
+  Receiver::Response receive_(const duration_type& /* timeout */) override
+  {
+    Receiver::Response output;
+    int value = 0;
+    if (read(fd_, &value, sizeof(value)) != sizeof(value)) {
+      throw dunedaq::ipm::ReceiveTimeoutExpired(ERS_HERE, 0);
+    }
+    auto bytes = reinterpret_cast<const char*>(&value); // NOLINT
+    output.data.assign(bytes, bytes + sizeof(value));
+    return output;
+  }
+
+private:
+  int fd_;
+};
+
+class PipeSender : public Sender
+{
+public:
+  explicit PipeSender(int fd)
+    : fd_(fd)
+  {}
+
+  void connect_for_sends(const nlohmann::json& /* connection_info */) override {}
+  bool can_send() const noexcept override { return true; }
+  PollHandle poll_handle() noexcept override
+  {
+    PollHandle handle;
+    handle.fd = fd_;
+    return handle;
+  }
+
+protected:
+  void send_(const void* message, int N, const duration_type& timeout, std::string const& metadata) override
+  {
+    check_status(try_send_(message, N, timeout, metadata), timeout);
+  }
+
+  Status try_send_(const void* message, int N, const duration_type& /* timeout */, std::string const&) override
+  {
+    if (write(fd_, message, N) == N) {
+      return Status::Ok;
+    }
+    return errno == EAGAIN ? Status::Timeout : Status::Error;
+  }
+
+private:
+  int fd_;
+};
+
+// Starts running straight away, and cleans up after itself when it finishes
+struct DetachedTask
+{
+  struct promise_type
+  {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+DetachedTask
+receive_ints(Receiver& receiver, int count, std::vector<int>& received, Status& last_status)
+{
+  for (int i = 0; i < count; ++i) {
+    auto result = co_await async_receive(receiver, std::chrono::milliseconds(1000));
+    last_status = result.status;
+    if (!result) {
+      co_return;
+    }
+    received.push_back(*result->data.data_as<int>());
+  }
+}
+
+DetachedTask
+send_ints(Sender& sender, int count, std::vector<Status>& statuses)
+{
+  for (int i = 0; i < count; ++i) {
+    statuses.push_back(co_await async_send(sender, &i, sizeof(i), std::chrono::milliseconds(1000)));
+  }
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(Pipe)
+{
+  int fds[2];
+  BOOST_REQUIRE(pipe2(fds, O_NONBLOCK) == 0);
+  PipeReceiver theReceiver(fds[0]);
+  PipeSender theSender(fds[1]);
+
+  // The pipe holds far fewer than this many ints, so the sender is suspended until the
+  // receiver has made room, and the receiver whenever the pipe runs empty
+  constexpr int count = 100000;
+  std::vector<int> received;
+  Status last_status = Status::Error;
+  std::vector<Status> statuses;
+  receive_ints(theReceiver, count, received, last_status);
+  send_ints(theSender, count, statuses);
+  Reactor::instance().run();
+  close(fds[0]);
+  close(fds[1]);
+
+  BOOST_REQUIRE_EQUAL(statuses.size(), count);
+  BOOST_REQUIRE_EQUAL(received.size(), count);
+  for (int i = 0; i < count; ++i) {
+    BOOST_REQUIRE(statuses[i] == Status::Ok);
+    BOOST_REQUIRE_EQUAL(received[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendAndReceive)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://Awaitable_test_send_and_receive" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<int> received;
+  Status last_status = Status::Error;
+  std::vector<Status> statuses;
+  receive_ints(*theReceiver, 100, received, last_status);
+  send_ints(*theSender, 100, statuses);
+  Reactor::instance().run();
+
+  BOOST_REQUIRE_EQUAL(statuses.size(), 100);
+  BOOST_REQUIRE_EQUAL(received.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    BOOST_REQUIRE(statuses[i] == Status::Ok);
+    BOOST_REQUIRE_EQUAL(received[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveTimeout)
+{
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  theReceiver->connect_for_receives({ { "connection_string", "inproc://Awaitable_test_receive_timeout" } });
+
+  // Nothing is sent, so the coroutine is resumed by the deadline
+  std::vector<int> received;
+  Status last_status = Status::Ok;
+  auto start = std::chrono::steady_clock::now();
+  receive_ints(*theReceiver, 1, received, last_status);
+  Reactor::instance().run();
+  BOOST_REQUIRE(last_status == Status::Timeout);
+  BOOST_REQUIRE(received.empty());
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+/**
+ * @file BufferPool_test.cxx BufferPool class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/BufferPool.hpp"
+
+#define BOOST_TEST_MODULE BufferPool_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(BufferPool_test)
+
+BOOST_AUTO_TEST_CASE(SizeClasses)
+{
+  auto& pool = BufferPool::instance();
+  BOOST_REQUIRE_EQUAL(pool.allocate(0).capacity(), 64);
+  BOOST_REQUIRE_EQUAL(pool.allocate(64).capacity(), 64);
+  BOOST_REQUIRE_EQUAL(pool.allocate(65).capacity(), 128);
+  BOOST_REQUIRE_EQUAL(pool.allocate(5000).capacity(), 8192);
+  BOOST_REQUIRE_EQUAL(pool.allocate(BufferPool::max_block_size).capacity(), BufferPool::max_block_size);
+
+  auto oversize_allocations = pool.statistics().oversize_allocations;
+  BOOST_REQUIRE_EQUAL(pool.allocate(BufferPool::max_block_size + 1).capacity(), BufferPool::max_block_size + 1);
+  BOOST_REQUIRE_EQUAL(pool.statistics().oversize_allocations, oversize_allocations + 1);
+}
+
+BOOST_AUTO_TEST_CASE(Reuse)
+{
+  auto& pool = BufferPool::instance();
+  auto block = pool.allocate(300);
+  BOOST_REQUIRE(block);
+  auto data = block.data();
+  block.reset();
+  BOOST_REQUIRE(!block);
+
+  // The block just released is the first one this thread gets back
+  auto before = pool.statistics();
+  auto again = pool.allocate(400);
+  BOOST_REQUIRE_EQUAL(static_cast<void*>(again.data()), static_cast<void*>(data));
+  auto after = pool.statistics();
+  BOOST_REQUIRE_EQUAL(after.allocations, before.allocations + 1);
+  BOOST_REQUIRE_EQUAL(after.thread_cache_hits, before.thread_cache_hits + 1);
+  BOOST_REQUIRE_EQUAL(after.system_allocations, before.system_allocations);
+}
+
+BOOST_AUTO_TEST_CASE(MessageBuffers)
+{
+  auto& pool = BufferPool::instance();
+  auto in_use = pool.statistics().blocks_in_use;
+
+  std::string text = "Pooled message";
+  auto message = pool.copy(text.data(), text.size());
+  BOOST_REQUIRE_EQUAL(std::string(message.begin(), message.end()), text);
+  BOOST_REQUIRE(pool.copy(nullptr, 0).empty());
+
+  auto block = pool.allocate(sizeof(int));
+  int value = 42;
+  std::memcpy(block.data(), &value, sizeof(value));
+  auto moved = std::move(block).to_message_buffer(sizeof(int));
+  BOOST_REQUIRE(!block);
+  BOOST_REQUIRE_EQUAL(moved.size(), sizeof(int));
+  BOOST_REQUIRE_EQUAL(*moved.data_as<int>(), 42);
+  BOOST_REQUIRE_EQUAL(pool.statistics().blocks_in_use, in_use + 2);
+
+  // Destroying the MessageBuffers gives the blocks back
+  message.reset();
+  moved = MessageBuffer();
+  BOOST_REQUIRE_EQUAL(pool.statistics().blocks_in_use, in_use);
+}
+
+BOOST_AUTO_TEST_CASE(AcrossThreads)
+{
+  // Blocks allocated by one thread and released by another find their way back through
+  // the depot, so a long stream of messages needs few new blocks
+  auto& pool = BufferPool::instance();
+  auto before = pool.statistics();
+
+  constexpr int n_rounds = 200;
+  constexpr int n_messages = 100;
+  for (int round = 0; round < n_rounds; ++round) {
+    std::vector<MessageBuffer> messages;
+    std::thread producer([&] {
+      for (int i = 0; i < n_messages; ++i) {
+        messages.push_back(pool.copy(&i, sizeof(i)));
+      }
+    });
+    producer.join();
+    std::thread consumer([&] {
+      for (int i = 0; i < n_messages; ++i) {
+        BOOST_REQUIRE_EQUAL(*messages[i].data_as<int>(), i);
+      }
+      messages.clear();
+    });
+    consumer.join();
+  }
+
+  auto after = pool.statistics();
+  BOOST_REQUIRE_EQUAL(after.allocations - before.allocations, n_rounds * n_messages);
+  BOOST_REQUIRE_EQUAL(after.blocks_in_use, before.blocks_in_use);
+  BOOST_REQUIRE(after.depot_refills > before.depot_refills);
+  BOOST_REQUIRE(after.system_allocations - before.system_allocations < n_rounds * n_messages / 10);
+}
+
+BOOST_AUTO_TEST_CASE(NumaNodes)
+{
+  // A block belongs to the node of the thread which first allocated it, wherever it is
+  // released, so it comes back to a thread on that node
+  auto& pool = BufferPool::instance();
+  auto node = static_cast<size_t>(std::max(placement::current_node(), 0)) % BufferPool::max_nodes;
+  auto block = pool.allocate(2000);
+  BOOST_REQUIRE_EQUAL(block.node(), node);
+  auto data = block.data();
+  std::thread releaser([&] { block.reset(); });
+  releaser.join();
+
+  std::vector<BufferPool::Block> blocks;
+  bool found = false;
+  for (size_t i = 0; i < 256 && !found; ++i) {
+    blocks.push_back(pool.allocate(2000));
+    BOOST_REQUIRE_EQUAL(blocks.back().node(), node);
+    found = blocks.back().data() == data;
+  }
+  BOOST_REQUIRE(found);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
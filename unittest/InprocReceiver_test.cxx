@@ -0,0 +1,98 @@
+/**
+ * @file InprocReceiver_test.cxx InprocReceiver class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/InprocRegistry.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE InprocReceiver_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(InprocReceiver_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  BOOST_REQUIRE(theReceiver != nullptr);
+  BOOST_REQUIRE(!theReceiver->can_receive());
+}
+
+BOOST_AUTO_TEST_CASE(SendReceive)
+{
+  auto theSender = makeIPMSender("InprocSender");
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocReceiver_test" } };
+  theReceiver->connect_for_receives(connection_info);
+  theSender->connect_for_sends(connection_info);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver->receive(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+  BOOST_REQUIRE(theReceiver->try_receive_buffer(Receiver::noblock).status == Status::Timeout);
+
+  // A blocked receive is woken by the send
+  std::thread sender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    theSender->send(test_data.data(), test_data.size(), Sender::block);
+  });
+  auto buffer = theReceiver->receive_buffer(Receiver::block);
+  BOOST_REQUIRE_EQUAL(buffer.data.size(), 4);
+  BOOST_REQUIRE(buffer.metadata.empty());
+  sender.join();
+}
+
+BOOST_AUTO_TEST_CASE(OneReceiver)
+{
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  auto otherReceiver = makeIPMReceiver("InprocReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocReceiver_test_one" } };
+  theReceiver->connect_for_receives(connection_info);
+  BOOST_REQUIRE_EXCEPTION(otherReceiver->connect_for_receives(connection_info),
+                          dunedaq::ipm::InprocReceiverAlreadyConnected,
+                          [&](dunedaq::ipm::InprocReceiverAlreadyConnected) { return true; });
+  BOOST_REQUIRE(!otherReceiver->can_receive());
+
+  // Once the first goes away, another can connect
+  theReceiver.reset();
+  otherReceiver->connect_for_receives(connection_info);
+  BOOST_REQUIRE(otherReceiver->can_receive());
+}
+
+BOOST_AUTO_TEST_CASE(CapacityMismatch)
+{
+  auto theSender = makeIPMSender("InprocSender");
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  theSender->connect_for_sends({ { "connection_string", "inproc://InprocReceiver_test_capacity" },
+                                 { "queue_capacity", 16 } });
+
+  // Both sides have to agree on the queue's capacity
+  BOOST_REQUIRE_EXCEPTION(
+    theReceiver->connect_for_receives({ { "connection_string", "inproc://InprocReceiver_test_capacity" } }),
+    dunedaq::ipm::InprocCapacityMismatch,
+    [&](dunedaq::ipm::InprocCapacityMismatch) { return true; });
+  BOOST_REQUIRE(!theReceiver->can_receive());
+
+  theReceiver->connect_for_receives({ { "connection_string", "inproc://InprocReceiver_test_capacity" },
+                                      { "queue_capacity", 16 } });
+  BOOST_REQUIRE(theReceiver->can_receive());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+/**
+ * @file InprocSender_test.cxx InprocSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE InprocSender_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(InprocSender_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theSender = makeIPMSender("InprocSender");
+  BOOST_REQUIRE(theSender != nullptr);
+  BOOST_REQUIRE(!theSender->can_send());
+
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocSender_test_basic" } };
+  theSender->connect_for_sends(connection_info);
+  BOOST_REQUIRE(theSender->can_send());
+}
+
+BOOST_AUTO_TEST_CASE(SendTimeout)
+{
+  auto theSender = makeIPMSender("InprocSender");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocSender_test_timeout" },
+                                     { "queue_capacity", 4 } };
+  theSender->connect_for_sends(connection_info);
+
+  // With nothing receiving, the queue fills up
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (int i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok);
+  }
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)) ==
+                Status::Timeout);
+  BOOST_REQUIRE_EXCEPTION(theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(LongTimeout)
+{
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  auto theSender = makeIPMSender("InprocSender");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocSender_test_long" },
+                                     { "queue_capacity", 4 } };
+  theReceiver->connect_for_receives(connection_info);
+  theSender->connect_for_sends(connection_info);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (int i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok);
+  }
+
+  // A timeout of a thousand years runs past the end of the clock, so it waits for room
+  // as if it were blocking rather than timing out at once
+  auto status = std::async(std::launch::async, [&] {
+    return theSender->try_send(test_data.data(), test_data.size(), std::chrono::hours(24 * 365 * 1000));
+  });
+  BOOST_REQUIRE(status.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout);
+  theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(status.get() == Status::Ok);
+}
+
+BOOST_AUTO_TEST_CASE(SendBuffer)
+{
+  auto theSender = makeIPMSender("InprocSender");
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocSender_test_buffer" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  // The Receiver gets the Sender's own buffer
+  auto owner = std::make_shared<std::vector<char>>(1 << 20, 'B');
+  const char* payload = owner->data();
+  std::weak_ptr<std::vector<char>> watcher = owner;
+  theSender->send(MessageBuffer::adopt(std::move(owner), payload, 1 << 20), Sender::block, "topic");
+
+  {
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE(response.data.data() == payload);
+    BOOST_REQUIRE_EQUAL(response.data.size(), 1 << 20);
+    BOOST_REQUIRE_EQUAL(std::string(response.metadata.begin(), response.metadata.end()), "topic");
+    BOOST_REQUIRE(!watcher.expired());
+  }
+  BOOST_REQUIRE(watcher.expired());
+}
+
+BOOST_AUTO_TEST_CASE(ManySenders)
+{
+  auto theReceiver = makeIPMReceiver("InprocReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://InprocSender_test_many" },
+                                     { "queue_capacity", 16 } };
+  theReceiver->connect_for_receives(connection_info);
+
+  constexpr int nsenders = 4;
+  constexpr int nmessages = 10000;
+  std::vector<std::thread> threads;
+  for (int s = 0; s < nsenders; ++s) {
+    threads.emplace_back([&, s] {
+      auto theSender = makeIPMSender("InprocSender");
+      theSender->connect_for_sends(connection_info);
+      for (int i = 0; i < nmessages; ++i) {
+        int value = s * nmessages + i;
+        theSender->send(&value, sizeof(value), Sender::block);
+      }
+    });
+  }
+
+  // Each Sender's messages arrive in order
+  std::vector<int> next(nsenders, 0);
+  for (int i = 0; i < nsenders * nmessages; ++i) {
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+    auto value = *response.data.data_as<int>();
+    BOOST_REQUIRE_EQUAL(value % nmessages, next[value / nmessages]++);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
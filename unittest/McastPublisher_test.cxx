@@ -0,0 +1,99 @@
+/**
+ * @file McastPublisher_test.cxx McastPublisher class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
+
+#define BOOST_TEST_MODULE McastPublisher_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(McastPublisher_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  BOOST_REQUIRE(theSender != nullptr);
+  BOOST_REQUIRE(!theSender->can_send());
+
+  BOOST_REQUIRE_THROW(theSender->connect_for_sends({ { "connection_string", "udp://127.0.0.1:29700" } }),
+                      ers::Issue);
+  BOOST_REQUIRE(!theSender->can_send());
+
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29700" },
+                                     { "interface", "127.0.0.1" } };
+  theSender->connect_for_sends(connection_info);
+  BOOST_REQUIRE(theSender->can_send());
+
+  // Nobody has to be listening
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok);
+
+  // The topic has to fit in the first datagram
+  BOOST_REQUIRE_THROW(theSender->send(test_data.data(), test_data.size(), Sender::block, std::string(2000, 't')),
+                      ers::Issue);
+}
+
+BOOST_AUTO_TEST_CASE(SendBatch)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29701" },
+                                     { "interface", "127.0.0.1" } };
+  theSubscriber->connect_for_receives(connection_info);
+  theSubscriber->subscribe("");
+  theSender->connect_for_sends(connection_info);
+
+  // The batch goes out as a run of datagrams, each message arriving as its own
+  std::vector<std::vector<char>> messages;
+  std::vector<std::string> topics;
+  for (int i = 0; i < 100; ++i) {
+    messages.emplace_back(1 + i * 30, static_cast<char>(i));
+    topics.push_back(std::to_string(i));
+  }
+  std::vector<Sender::BatchEntry> batch;
+  for (int i = 0; i < 100; ++i) {
+    batch.push_back({ messages[i].data(), static_cast<Sender::size_type>(messages[i].size()), topics[i] });
+  }
+  theSender->send_batch(batch, std::chrono::milliseconds(1000));
+  for (int i = 0; i < 100; ++i) {
+    auto response = theSubscriber->receive(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE(response.data == messages[i]);
+    BOOST_REQUIRE_EQUAL(response.metadata, topics[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendMultipart)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29702" },
+                                     { "interface", "127.0.0.1" } };
+  theSubscriber->connect_for_receives(connection_info);
+  theSubscriber->subscribe("topic");
+  theSender->connect_for_sends(connection_info);
+
+  // The parts arrive as one message, split across datagrams
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload(5000, 'P');
+  const void* parts[] = { header.data(), payload.data() };
+  theSender->send_multipart(parts, { 3, 5000 }, Sender::block, "topic");
+
+  auto response = theSubscriber->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(response.data.size(), 5003);
+  BOOST_REQUIRE(std::string(response.data.begin(), response.data.begin() + 3) == "HDR");
+  BOOST_REQUIRE_EQUAL(response.data[5002], 'P');
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
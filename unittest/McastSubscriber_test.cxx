@@ -0,0 +1,147 @@
+/**
+ * @file McastSubscriber_test.cxx McastSubscriber class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
+
+#define BOOST_TEST_MODULE McastSubscriber_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(McastSubscriber_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  BOOST_REQUIRE(theSubscriber != nullptr);
+  BOOST_REQUIRE(!theSubscriber->can_receive());
+
+  auto theReceiver = makeIPMReceiver("McastSubscriber");
+  BOOST_REQUIRE(theReceiver != nullptr);
+
+  BOOST_REQUIRE_THROW(theSubscriber->connect_for_receives({ { "connection_string", "udp://127.0.0.1:29710" } }),
+                      ers::Issue);
+  BOOST_REQUIRE_THROW(theSubscriber->connect_for_receives({ { "connection_string", "udp://239.255.0.1:port" } }),
+                      ers::Issue);
+  BOOST_REQUIRE_THROW(theSubscriber->connect_for_receives({ { "connection_string", "udp://239.255.0.1:65536" } }),
+                      ers::Issue);
+  theSubscriber->connect_for_receives({ { "connection_string", "udp://239.255.0.1:29710" },
+                                        { "interface", "127.0.0.1" } });
+  BOOST_REQUIRE(theSubscriber->can_receive());
+  BOOST_REQUIRE(theSubscriber->try_receive(std::chrono::milliseconds(10)).status == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(TopicFiltering)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29711" },
+                                     { "interface", "127.0.0.1" } };
+  theSubscriber->connect_for_receives(connection_info);
+  theSender->connect_for_sends(connection_info);
+
+  // Nothing is kept until something is subscribed to
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "trigger");
+  BOOST_REQUIRE(theSubscriber->try_receive(std::chrono::milliseconds(20)).status == Status::Timeout);
+
+  // Topics are matched by prefix, and a large message not subscribed to is skipped whole
+  theSubscriber->subscribe("trig");
+  std::vector<char> big_data(100000, 'B');
+  theSender->send(big_data.data(), big_data.size(), Sender::block, "monitoring");
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "trigger");
+  auto response = theSubscriber->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "trigger");
+
+  theSubscriber->unsubscribe("trig");
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "trigger");
+  BOOST_REQUIRE(theSubscriber->try_receive(std::chrono::milliseconds(20)).status == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(FanOut)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29712" },
+                                     { "interface", "127.0.0.1" },
+                                     { "datagram_size", 8192 } };
+  std::vector<std::shared_ptr<Subscriber>> subscribers;
+  for (int i = 0; i < 5; ++i) {
+    subscribers.push_back(makeIPMSubscriber("McastSubscriber"));
+    subscribers.back()->connect_for_receives(connection_info);
+    subscribers.back()->subscribe("");
+  }
+  theSender->connect_for_sends(connection_info);
+
+  // One send reaches every subscriber, reassembled from many datagrams
+  std::vector<char> big_data(200000);
+  for (size_t i = 0; i < big_data.size(); ++i) {
+    big_data[i] = static_cast<char>(i % 251);
+  }
+  theSender->send(big_data.data(), big_data.size(), Sender::block, "topic");
+  for (auto& subscriber : subscribers) {
+    auto buffer = subscriber->receive_buffer(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE_EQUAL(buffer.data.size(), big_data.size());
+    BOOST_REQUIRE(std::equal(buffer.data.begin(), buffer.data.end(), big_data.begin()));
+    BOOST_REQUIRE_EQUAL(std::string(buffer.metadata.begin(), buffer.metadata.end()), "topic");
+  }
+
+  BOOST_REQUIRE_EXCEPTION(subscribers[0]->receive(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(MaxMessageSize)
+{
+  auto theSender = makeIPMSender("McastPublisher");
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29713" },
+                                     { "interface", "127.0.0.1" },
+                                     { "max_message_size", 1000 } };
+  theSubscriber->connect_for_receives(connection_info);
+  theSubscriber->subscribe("");
+  theSender->connect_for_sends(connection_info);
+
+  // The topic counts towards the size too
+  std::vector<char> test_data(996, 'T');
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "top");
+  auto response = theSubscriber->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "top");
+}
+
+BOOST_AUTO_TEST_CASE(ForgetsPublishers)
+{
+  auto theSubscriber = makeIPMSubscriber("McastSubscriber");
+  nlohmann::json connection_info = { { "connection_string", "udp://239.255.0.1:29714" },
+                                     { "interface", "127.0.0.1" },
+                                     { "publisher_timeout_ms", 50 } };
+  theSubscriber->connect_for_receives(connection_info);
+  theSubscriber->subscribe("");
+
+  // Each publisher has an ID of its own, and is forgotten once it's been quiet for long enough
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (int i = 0; i < 3; ++i) {
+    auto theSender = makeIPMSender("McastPublisher");
+    theSender->connect_for_sends(connection_info);
+    theSender->send(test_data.data(), test_data.size(), Sender::block);
+    BOOST_REQUIRE(theSubscriber->receive(std::chrono::milliseconds(1000)).data == test_data);
+    BOOST_REQUIRE_EQUAL(theSubscriber->statistics().value<size_t>("publishers", 0), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+/**
+ * @file MessageBuffer_test.cxx MessageBuffer class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/MessageBuffer.hpp"
+
+#define BOOST_TEST_MODULE MessageBuffer_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(MessageBuffer_test)
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<MessageBuffer>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<MessageBuffer>);
+  BOOST_REQUIRE(std::is_nothrow_move_constructible_v<MessageBuffer>);
+  BOOST_REQUIRE(std::is_nothrow_move_assignable_v<MessageBuffer>);
+}
+
+BOOST_AUTO_TEST_CASE(AdoptContainer)
+{
+  std::vector<char> bytes(10, 'A');
+  const char* original_data = bytes.data();
+
+  auto buffer = MessageBuffer::adopt(std::move(bytes));
+  BOOST_REQUIRE_EQUAL(buffer.size(), 10);
+  BOOST_REQUIRE_EQUAL(buffer.data(), original_data);
+  BOOST_REQUIRE_EQUAL(std::string(buffer.begin(), buffer.end()), std::string(10, 'A'));
+
+  auto topic = MessageBuffer::adopt(std::string("TEST"));
+  BOOST_REQUIRE_EQUAL(std::string(topic.begin(), topic.end()), "TEST");
+
+  MessageBuffer moved_to(std::move(buffer));
+  BOOST_REQUIRE(buffer.empty()); // NOLINT
+  BOOST_REQUIRE_EQUAL(moved_to.data(), original_data);
+}
+
+BOOST_AUTO_TEST_CASE(OwnerIsReleased)
+{
+  auto owner = std::make_shared<std::vector<int>>(5, 42);
+  std::weak_ptr<std::vector<int>> watcher = owner;
+  const void* data = owner->data();
+  auto size = static_cast<MessageBuffer::size_type>(owner->size() * sizeof(int));
+
+  auto buffer = MessageBuffer::adopt(std::move(owner), data, size);
+  BOOST_REQUIRE(!watcher.expired());
+  BOOST_REQUIRE_EQUAL(buffer.data_as<int>()[4], 42);
+
+  MessageBuffer other;
+  other = std::move(buffer);
+  BOOST_REQUIRE(!watcher.expired());
+
+  other.reset();
+  BOOST_REQUIRE(watcher.expired());
+  BOOST_REQUIRE(other.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
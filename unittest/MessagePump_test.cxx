@@ -0,0 +1,244 @@
+/**
+ * @file MessagePump_test.cxx MessagePump class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/MessagePump.hpp"
+
+#define BOOST_TEST_MODULE MessagePump_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(MessagePump_test)
+
+namespace {
+
+class ReceiverImpl : public Receiver
+{
+
+public:
+  static const size_type bytesOnEachReceive = 10;
+
+  ~ReceiverImpl() override { destroyed = true; }
+
+  void connect_for_receives(const nlohmann::json& /* connection_info */) override {}
+  bool can_receive() const noexcept override { return can_receive_; }
+  void make_me_ready_to_receive() { can_receive_ = true; }
+  void sabotage_my_receiving_ability() { can_receive_ = false; }
+  void fail_after(int messages) { messages_before_failure_ = messages; }
+
+  void move_buffers_to_local_node() override { ++times_placed; }
+
+  std::atomic<int> times_placed{ 0 };
+  static std::atomic<bool> destroyed;
+
+protected:
+  Receiver::Response receive_(const duration_type& /* timeout */) override
+  {
+    Receiver::Response output;
+    output.data = std::vector<char>(bytesOnEachReceive, 'A');
+    return output;
+  }
+
+  Result<BufferResponse> try_receive_buffer_(const duration_type& timeout) override
+  {
+    if (messages_before_failure_ == 0) {
+      return { Status::Error, {} };
+    }
+    --messages_before_failure_;
+    return Receiver::try_receive_buffer_(timeout);
+  }
+
+private:
+  std::atomic<bool> can_receive_{ false };
+  int messages_before_failure_{ -1 };
+};
+
+std::atomic<bool> ReceiverImpl::destroyed{ false };
+
+template<typename Predicate>
+bool
+wait_until(Predicate predicate)
+{
+  auto start = std::chrono::steady_clock::now();
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(CopyAndMoveSemantics)
+{
+  BOOST_REQUIRE(!std::is_copy_constructible_v<MessagePump>);
+  BOOST_REQUIRE(!std::is_copy_assignable_v<MessagePump>);
+  BOOST_REQUIRE(!std::is_move_constructible_v<MessagePump>);
+  BOOST_REQUIRE(!std::is_move_assignable_v<MessagePump>);
+}
+
+BOOST_AUTO_TEST_CASE(OnMessage)
+{
+  auto theReceiver = std::make_shared<ReceiverImpl>();
+  MessagePump thePump(theReceiver);
+
+  BOOST_REQUIRE_EXCEPTION(
+    thePump.start(), dunedaq::ipm::NoMessageCallback, [&](dunedaq::ipm::NoMessageCallback) { return true; });
+
+  // Directly on the I/O thread, then through a queue to a worker thread
+  for (Receiver::size_type queue_capacity : { 0, 4 }) {
+    std::atomic<int> received{ 0 };
+    thePump.on_message(
+      [&](Receiver::BufferResponse& message) {
+        if (message.data.size() == ReceiverImpl::bytesOnEachReceive) {
+          ++received;
+        }
+      },
+      queue_capacity);
+
+    theReceiver->sabotage_my_receiving_ability();
+    BOOST_REQUIRE_EXCEPTION(thePump.start(),
+                            dunedaq::ipm::KnownStateForbidsReceive,
+                            [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
+
+    theReceiver->make_me_ready_to_receive();
+    thePump.start();
+    BOOST_REQUIRE(thePump.is_running());
+    BOOST_REQUIRE_EXCEPTION(thePump.start(),
+                            dunedaq::ipm::MessagePumpAlreadyStarted,
+                            [&](dunedaq::ipm::MessagePumpAlreadyStarted) { return true; });
+
+    BOOST_REQUIRE(wait_until([&] { return received.load() >= 100; }));
+    thePump.stop();
+    BOOST_REQUIRE(!thePump.is_running());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SlowCallback)
+{
+  auto theReceiver = std::make_shared<ReceiverImpl>();
+  theReceiver->make_me_ready_to_receive();
+  MessagePump thePump(theReceiver);
+
+  std::atomic<int> received{ 0 };
+  thePump.on_message(
+    [&](Receiver::BufferResponse& /* message */) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      ++received;
+    },
+    2);
+
+  // The Receiver always has a message ready, so the queue stays full; the I/O thread
+  // sleeps until the worker makes room rather than spinning on it
+  auto cpu_start = std::clock();
+  thePump.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto cpu_seconds = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  thePump.stop();
+  BOOST_TEST_MESSAGE("The pump used " << cpu_seconds << " s of CPU time");
+  BOOST_REQUIRE(cpu_seconds < 0.2);
+  BOOST_REQUIRE(received.load() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiverFails)
+{
+  auto theReceiver = std::make_shared<ReceiverImpl>();
+  theReceiver->make_me_ready_to_receive();
+  MessagePump thePump(theReceiver);
+
+  // Everything received before the failure is delivered, and the pump stops by itself
+  for (Receiver::size_type queue_capacity : { 0, 4 }) {
+    std::atomic<int> received{ 0 };
+    theReceiver->fail_after(50);
+    thePump.on_message([&](Receiver::BufferResponse&) { ++received; }, queue_capacity);
+    thePump.start();
+    BOOST_REQUIRE(wait_until([&] { return !thePump.is_running(); }));
+    thePump.stop();
+    BOOST_REQUIRE_EQUAL(received.load(), 50);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OwnsReceiver)
+{
+  ReceiverImpl::destroyed = false;
+  std::atomic<int> received{ 0 };
+  std::atomic<bool> delivered_after_destruction{ false };
+  {
+    auto thePump = std::make_unique<MessagePump>(std::make_shared<ReceiverImpl>());
+    std::static_pointer_cast<ReceiverImpl>(thePump->receiver())->make_me_ready_to_receive();
+    thePump->on_message(
+      [&](Receiver::BufferResponse&) {
+        // The Receiver is only destroyed once the threads using it have stopped
+        if (ReceiverImpl::destroyed) {
+          delivered_after_destruction = true;
+        }
+        ++received;
+      },
+      4);
+    thePump->start();
+    BOOST_REQUIRE(wait_until([&] { return received.load() >= 10; }));
+  }
+  BOOST_REQUIRE(ReceiverImpl::destroyed);
+  BOOST_REQUIRE(!delivered_after_destruction);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPlacement)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  sched_getaffinity(0, sizeof(set), &set);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  int io_cpu = cpus.front();
+  int worker_cpu = cpus.back();
+
+  auto theReceiver = std::make_shared<ReceiverImpl>();
+  theReceiver->make_me_ready_to_receive();
+  MessagePump thePump(theReceiver);
+  thePump.set_thread_placement({ { "io_thread_cpus", { io_cpu } }, { "worker_thread_cpus", { worker_cpu } } });
+
+  // The callback runs on the I/O thread, then on the worker
+  for (Receiver::size_type queue_capacity : { 0, 4 }) {
+    std::atomic<int> ran_on{ -1 };
+    thePump.on_message([&](Receiver::BufferResponse&) { ran_on = sched_getcpu(); }, queue_capacity);
+    thePump.start();
+    BOOST_REQUIRE_EXCEPTION(thePump.set_thread_placement({}),
+                            dunedaq::ipm::MessagePumpAlreadyStarted,
+                            [&](dunedaq::ipm::MessagePumpAlreadyStarted) { return true; });
+    BOOST_REQUIRE(wait_until([&] { return ran_on.load() >= 0; }));
+    thePump.stop();
+    BOOST_REQUIRE_EQUAL(ran_on.load(), queue_capacity == 0 ? io_cpu : worker_cpu);
+  }
+  BOOST_REQUIRE_EQUAL(theReceiver->times_placed.load(), 2);
+
+  // Without any CPUs the Receiver's buffers aren't moved
+  thePump.set_thread_placement({});
+  thePump.on_message([](Receiver::BufferResponse&) {});
+  thePump.start();
+  thePump.stop();
+  BOOST_REQUIRE_EQUAL(theReceiver->times_placed.load(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
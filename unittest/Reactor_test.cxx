@@ -0,0 +1,79 @@
+/**
+ * @file Reactor_test.cxx Reactor class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Reactor.hpp"
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE Reactor_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(Reactor_test)
+
+BOOST_AUTO_TEST_CASE(CannotWaitOnInvalidHandle)
+{
+  Reactor theReactor;
+  BOOST_REQUIRE_EXCEPTION(
+    theReactor.wait(PollHandle(), Reactor::Interest::Readable, Reactor::deadline_for(Reactor::block), [](bool) {
+      return true;
+    }),
+    dunedaq::ipm::ReactorCannotWait,
+    [&](dunedaq::ipm::ReactorCannotWait) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(Callbacks)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://Reactor_test_callbacks" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  Reactor theReactor;
+
+  // Nothing arrives, so the deadline expires
+  bool expired = false;
+  theReactor.wait(theReceiver->poll_handle(),
+                  Reactor::Interest::Readable,
+                  Reactor::deadline_for(std::chrono::milliseconds(20)),
+                  [&](bool timed_out) {
+                    expired = timed_out;
+                    return true;
+                  });
+  auto start = std::chrono::steady_clock::now();
+  theReactor.run();
+  BOOST_REQUIRE(expired);
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+  Result<Receiver::Response> result;
+  theReactor.wait(theReceiver->poll_handle(),
+                  Reactor::Interest::Readable,
+                  Reactor::deadline_for(std::chrono::milliseconds(1000)),
+                  [&](bool timed_out) {
+                    if (timed_out) {
+                      return true;
+                    }
+                    result = theReceiver->try_receive(Receiver::noblock);
+                    return result.status != Status::Timeout;
+                  });
+  BOOST_REQUIRE_EQUAL(theReactor.pending(), 1);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block);
+  theReactor.run();
+  BOOST_REQUIRE(result.ok());
+  BOOST_REQUIRE(result->data == test_data);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
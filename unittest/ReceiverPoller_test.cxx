@@ -0,0 +1,102 @@
+/**
+ * @file ReceiverPoller_test.cxx ReceiverPoller class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/ReceiverPoller.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE ReceiverPoller_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ReceiverPoller_test)
+
+namespace {
+
+// Has no poll handle, so can't be registered
+class UnpollableReceiver : public Receiver
+{
+public:
+  void connect_for_receives(const nlohmann::json& /* connection_info */) override {}
+  bool can_receive() const noexcept override { return true; }
+
+protected:
+  Receiver::Response receive_(const duration_type& /* timeout */) override { return Receiver::Response(); }
+};
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(Registration)
+{
+  ReceiverPoller thePoller;
+  BOOST_REQUIRE(thePoller.empty());
+
+  BOOST_REQUIRE_EXCEPTION(thePoller.add(std::make_shared<UnpollableReceiver>()),
+                          dunedaq::ipm::ReceiverNotPollable,
+                          [&](dunedaq::ipm::ReceiverNotPollable) { return true; });
+
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  thePoller.add(theReceiver);
+  thePoller.add(theReceiver);
+  BOOST_REQUIRE_EQUAL(thePoller.size(), 1);
+
+  BOOST_REQUIRE(thePoller.remove(theReceiver));
+  BOOST_REQUIRE(!thePoller.remove(theReceiver));
+  BOOST_REQUIRE(thePoller.empty());
+}
+
+BOOST_AUTO_TEST_CASE(PollAndDispatch)
+{
+  std::vector<std::shared_ptr<Sender>> senders;
+  std::vector<std::shared_ptr<Receiver>> receivers;
+  for (int i = 0; i < 3; ++i) {
+    nlohmann::json connection_info = { { "connection_string",
+                                         "inproc://ReceiverPoller_test_" + std::to_string(i) } };
+    senders.push_back(makeIPMSender("ZmqSender"));
+    senders.back()->connect_for_sends(connection_info);
+    receivers.push_back(makeIPMReceiver("ZmqReceiver"));
+    receivers.back()->connect_for_receives(connection_info);
+  }
+
+  std::vector<int> received(receivers.size(), 0);
+  ReceiverPoller thePoller;
+  for (size_t i = 0; i < receivers.size(); ++i) {
+    thePoller.add(receivers[i], [&received, i](Receiver& receiver) {
+      receiver.receive(Receiver::noblock);
+      ++received[i];
+    });
+  }
+
+  std::vector<std::shared_ptr<Receiver>> ready;
+  BOOST_REQUIRE_EQUAL(thePoller.poll(ready, std::chrono::milliseconds(10)), 0);
+  BOOST_REQUIRE(ready.empty());
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  senders[1]->send(test_data.data(), test_data.size(), Sender::block);
+  BOOST_REQUIRE_EQUAL(thePoller.poll(ready, std::chrono::milliseconds(1000)), 1);
+  BOOST_REQUIRE(ready[0] == receivers[1]);
+
+  senders[2]->send(test_data.data(), test_data.size(), Sender::block);
+  auto start = std::chrono::steady_clock::now();
+  while (std::accumulate(received.begin(), received.end(), 0) < 2 &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+    thePoller.dispatch(std::chrono::milliseconds(100));
+  }
+  BOOST_REQUIRE_EQUAL(received[0], 0);
+  BOOST_REQUIRE_EQUAL(received[1], 1);
+  BOOST_REQUIRE_EQUAL(received[2], 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
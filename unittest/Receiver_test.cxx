@@ -34,18 +34,25 @@ public:
   bool can_receive() const noexcept override { return can_receive_; }
   void make_me_ready_to_receive() { can_receive_ = true; }
   void sabotage_my_receiving_ability() { can_receive_ = false; }
+  void give_me_empty_messages() { payload_size_ = 0; }
+  void make_me_time_out() { times_out_ = true; }
 
 protected:
   Receiver::Response receive_(const duration_type& /* timeout */) override
   {
+    if (times_out_) {
+      throw dunedaq::ipm::ReceiveTimeoutExpired(ERS_HERE, 0);
+    }
     Receiver::Response output;
-    output.data = std::vector<char>(bytesOnEachReceive, 'A');
+    output.data = std::vector<char>(payload_size_, 'A');
     output.metadata = "";
     return output;
   }
 
 private:
   bool can_receive_;
+  size_type payload_size_{ bytesOnEachReceive };
+  bool times_out_{ false };
 };
 
 } // namespace ""
@@ -82,4 +89,98 @@ BOOST_AUTO_TEST_CASE(StatusChecks)
                           [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
 }
 
+BOOST_AUTO_TEST_CASE(ReceiveBuffer)
+{
+  ReceiverImpl theReceiver;
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver.receive_buffer(Receiver::noblock),
+                          dunedaq::ipm::KnownStateForbidsReceive,
+                          [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
+
+  theReceiver.make_me_ready_to_receive();
+
+  auto response = theReceiver.receive_buffer(Receiver::noblock, ReceiverImpl::bytesOnEachReceive);
+  BOOST_REQUIRE(response.data.size() == ReceiverImpl::bytesOnEachReceive);
+  BOOST_REQUIRE_EQUAL(response.data[0], 'A');
+  BOOST_REQUIRE(response.metadata.empty());
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver.receive_buffer(Receiver::noblock, ReceiverImpl::bytesOnEachReceive - 1),
+                          dunedaq::ipm::UnexpectedNumberOfBytes,
+                          [&](dunedaq::ipm::UnexpectedNumberOfBytes) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveMultipart)
+{
+  ReceiverImpl theReceiver;
+  theReceiver.make_me_ready_to_receive();
+
+  auto response = theReceiver.receive_multipart(Receiver::noblock);
+  BOOST_REQUIRE_EQUAL(response.data.size(), 1);
+  BOOST_REQUIRE(response.data[0].size() == ReceiverImpl::bytesOnEachReceive);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveInto)
+{
+  ReceiverImpl theReceiver;
+  theReceiver.make_me_ready_to_receive();
+
+  std::vector<char> buffer(ReceiverImpl::bytesOnEachReceive + 1, 'Z');
+  auto response = theReceiver.receive_into(buffer.data(), buffer.size(), Receiver::noblock);
+  BOOST_REQUIRE(response.size == ReceiverImpl::bytesOnEachReceive);
+  BOOST_REQUIRE(!response.truncated);
+  BOOST_REQUIRE_EQUAL(buffer[0], 'A');
+  BOOST_REQUIRE_EQUAL(buffer.back(), 'Z');
+
+  response = theReceiver.receive_into(buffer.data(), 2, Receiver::noblock);
+  BOOST_REQUIRE(response.size == ReceiverImpl::bytesOnEachReceive);
+  BOOST_REQUIRE(response.truncated);
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver.receive_into(nullptr, 2, Receiver::noblock),
+                          dunedaq::ipm::NullPointerPassedToReceive,
+                          [&](dunedaq::ipm::NullPointerPassedToReceive) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveBatch)
+{
+  ReceiverImpl theReceiver;
+  theReceiver.make_me_ready_to_receive();
+
+  std::vector<Receiver::BufferResponse> messages;
+  BOOST_REQUIRE_EQUAL(theReceiver.receive_batch(messages, 3, Receiver::noblock), 3);
+  BOOST_REQUIRE_EQUAL(messages.size(), 3);
+  BOOST_REQUIRE(messages[2].data.size() == ReceiverImpl::bytesOnEachReceive);
+
+  BOOST_REQUIRE_EQUAL(theReceiver.receive_batch(messages, 1, Receiver::noblock), 1);
+  BOOST_REQUIRE_EQUAL(messages.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(TryReceive)
+{
+  ReceiverImpl theReceiver;
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver.try_receive(Receiver::noblock),
+                          dunedaq::ipm::KnownStateForbidsReceive,
+                          [&](dunedaq::ipm::KnownStateForbidsReceive) { return true; });
+
+  theReceiver.make_me_ready_to_receive();
+  auto response = theReceiver.try_receive(Receiver::noblock);
+  BOOST_REQUIRE(response.ok());
+  BOOST_REQUIRE(response->data.size() == ReceiverImpl::bytesOnEachReceive);
+
+  auto buffer = theReceiver.try_receive_buffer(Receiver::noblock);
+  BOOST_REQUIRE(buffer.status == Status::Ok);
+  BOOST_REQUIRE(buffer->data.size() == ReceiverImpl::bytesOnEachReceive);
+
+  // A message without a payload is still a message
+  theReceiver.give_me_empty_messages();
+  BOOST_REQUIRE(theReceiver.try_receive(Receiver::noblock).status == Status::Ok);
+  buffer = theReceiver.try_receive_buffer(Receiver::noblock);
+  BOOST_REQUIRE(buffer.status == Status::Ok);
+  BOOST_REQUIRE(buffer->data.empty());
+
+  theReceiver.make_me_time_out();
+  BOOST_REQUIRE(theReceiver.try_receive(Receiver::noblock).status == Status::Timeout);
+  BOOST_REQUIRE(theReceiver.try_receive_buffer(Receiver::noblock).status == Status::Timeout);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,9 @@
 #define BOOST_TEST_MODULE Sender_test // NOLINT
 
 #include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -37,8 +40,12 @@ protected:
   void send_(const void* /* message */, int /* N */, const duration_type& /* timeout */, const std::string& /* metadata */) override
   {
     // Pretty unexciting stub
+    ++sends_;
   }
 
+public:
+  int sends_{ 0 };
+
 private:
   bool can_send_;
 };
@@ -84,4 +91,92 @@ BOOST_AUTO_TEST_CASE(BadInput)
                           [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
 }
 
+BOOST_AUTO_TEST_CASE(SendBuffer)
+{
+  SenderImpl theSender;
+  auto owner = std::make_shared<std::vector<char>>(4, 'T');
+  std::weak_ptr<std::vector<char>> watcher = owner;
+
+  auto make_buffer = [&]() {
+    return MessageBuffer::adopt(std::shared_ptr<std::vector<char>>(owner), owner->data(), owner->size());
+  };
+
+  BOOST_REQUIRE_EXCEPTION(theSender.send(make_buffer(), Sender::noblock),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  theSender.make_me_ready_to_send();
+  BOOST_REQUIRE_NO_THROW(theSender.send(make_buffer(), Sender::noblock));
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 1);
+
+  BOOST_REQUIRE_NO_THROW(theSender.send(MessageBuffer(), Sender::noblock));
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 1);
+
+  BOOST_REQUIRE_EXCEPTION(theSender.send(MessageBuffer(nullptr, 10, nullptr, nullptr), Sender::noblock),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+
+  std::vector<MessageBuffer> parts;
+  parts.push_back(make_buffer());
+  parts.push_back(make_buffer());
+  BOOST_REQUIRE_NO_THROW(theSender.send_multipart(std::move(parts), Sender::noblock));
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 3);
+
+  owner.reset();
+  BOOST_REQUIRE(watcher.expired());
+}
+
+BOOST_AUTO_TEST_CASE(SendBatch)
+{
+  SenderImpl theSender;
+  std::vector<char> random_data{ 'T', 'E', 'S', 'T' };
+  std::vector<Sender::BatchEntry> batch{ { random_data.data(), 4, "A" },
+                                         { random_data.data(), 0, "B" },
+                                         { random_data.data(), 2, "C" } };
+
+  BOOST_REQUIRE_EXCEPTION(theSender.send_batch(batch, Sender::noblock),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  theSender.make_me_ready_to_send();
+  BOOST_REQUIRE_NO_THROW(theSender.send_batch(batch, Sender::noblock));
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 2);
+
+  batch.push_back({ nullptr, 10, "D" });
+  BOOST_REQUIRE_EXCEPTION(theSender.send_batch(batch, Sender::noblock),
+                          dunedaq::ipm::NullPointerPassedToSend,
+                          [&](dunedaq::ipm::NullPointerPassedToSend) { return true; });
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 2);
+}
+
+BOOST_AUTO_TEST_CASE(TrySend)
+{
+  SenderImpl theSender;
+  std::vector<char> random_data{ 'T', 'E', 'S', 'T' };
+
+  BOOST_REQUIRE_EXCEPTION(theSender.try_send(random_data.data(), random_data.size(), Sender::noblock),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  theSender.make_me_ready_to_send();
+  BOOST_REQUIRE(theSender.try_send(random_data.data(), random_data.size(), Sender::noblock) == Status::Ok);
+  BOOST_REQUIRE(theSender.try_send(random_data.data(), 0, Sender::noblock) == Status::Ok);
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 1);
+}
+
+BOOST_AUTO_TEST_CASE(SendAsync)
+{
+  SenderImpl theSender;
+  BOOST_REQUIRE_EXCEPTION(theSender.send_async(MessageBuffer::adopt(std::string("TEST")), Sender::noblock),
+                          dunedaq::ipm::KnownStateForbidsSend,
+                          [&](dunedaq::ipm::KnownStateForbidsSend) { return true; });
+
+  // By default the message is sent before send_async returns
+  theSender.make_me_ready_to_send();
+  auto result = theSender.send_async(MessageBuffer::adopt(std::string("TEST")), Sender::noblock);
+  BOOST_REQUIRE(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  BOOST_REQUIRE(result.get() == Status::Ok);
+  BOOST_REQUIRE_EQUAL(theSender.sends_, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
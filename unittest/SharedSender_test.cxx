@@ -0,0 +1,169 @@
+/**
+ * @file SharedSender_test.cxx SharedSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/SharedSender.hpp"
+
+#define BOOST_TEST_MODULE SharedSender_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(SharedSender_test)
+
+namespace {
+
+// Takes "delay" over each message, so that the SharedSender's queue fills up
+class SlowSender : public Sender
+{
+public:
+  explicit SlowSender(std::chrono::milliseconds delay)
+    : delay_(delay)
+  {}
+
+  void connect_for_sends(const nlohmann::json& /* connection_info */) override {}
+  bool can_send() const noexcept override { return true; }
+
+  std::atomic<int> sent{ 0 };
+
+protected:
+  void send_(const void* /* message */, size_type /* N */, const duration_type& /* timeout */, std::string const&) override
+  {
+    std::this_thread::sleep_for(delay_);
+    ++sent;
+  }
+
+private:
+  std::chrono::milliseconds delay_;
+};
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theSender = makeIPMSender("SharedSender");
+  BOOST_REQUIRE(theSender != nullptr);
+  BOOST_REQUIRE(!theSender->can_send());
+
+  SharedSender decorator(makeIPMSender("TcpSender"));
+  BOOST_REQUIRE(!decorator.can_send());
+  decorator.connect_for_sends({ { "connection_string", "tcp://127.0.0.1:29530" } });
+  BOOST_REQUIRE(decorator.can_send());
+
+  // Producers may already be using the queue
+  BOOST_REQUIRE_EXCEPTION(decorator.connect_for_sends({ { "connection_string", "tcp://127.0.0.1:29530" } }),
+                          dunedaq::ipm::SharedSenderAlreadyConnected,
+                          [&](dunedaq::ipm::SharedSenderAlreadyConnected) { return true; });
+  BOOST_REQUIRE(decorator.can_send());
+}
+
+BOOST_AUTO_TEST_CASE(ManyProducers)
+{
+  auto theReceiver = makeIPMReceiver("TcpReceiver");
+  nlohmann::json connection_info = { { "connection_string", "tcp://127.0.0.1:29531" }, { "queue_capacity", 64 } };
+  theReceiver->connect_for_receives(connection_info);
+  auto theSender = std::make_shared<SharedSender>(makeIPMSender("TcpSender"));
+  theSender->connect_for_sends(connection_info);
+
+  // Each producer's messages arrive in the order it sent them, without the producers
+  // having to lock around the send
+  const int producers = 8;
+  const int messages = 1000;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < messages; ++i) {
+        std::vector<int> test_data{ p, i };
+        theSender->send(test_data.data(), test_data.size() * sizeof(int), Sender::block, std::to_string(p));
+      }
+    });
+  }
+
+  std::vector<int> next(producers, 0);
+  for (int i = 0; i < producers * messages; ++i) {
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(5000));
+    auto data = response.data.data_as<int>();
+    BOOST_REQUIRE_EQUAL(std::string(response.metadata.begin(), response.metadata.end()), std::to_string(data[0]));
+    BOOST_REQUIRE_EQUAL(data[1], next[data[0]]++);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PluginAndAsyncSend)
+{
+  auto theReceiver = makeIPMReceiver("TcpReceiver");
+  nlohmann::json connection_info = { { "connection_string", "tcp://127.0.0.1:29532" },
+                                     { "shared_plugin", "TcpSender" } };
+  theReceiver->connect_for_receives(connection_info);
+  auto theSender = makeIPMSender("SharedSender");
+  theSender->connect_for_sends(connection_info);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  auto delivered = theSender->send_async(MessageBuffer::adopt(std::vector<char>(test_data)), Sender::block, "topic");
+  BOOST_REQUIRE(delivered.get() == Status::Ok);
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+  // Messages still queued when the SharedSender goes away are sent first
+  for (int i = 0; i < 10; ++i) {
+    theSender->send(test_data.data(), test_data.size(), Sender::block);
+  }
+  theSender.reset();
+  for (int i = 0; i < 10; ++i) {
+    BOOST_REQUIRE(theReceiver->receive(std::chrono::milliseconds(1000)).data == test_data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BlockedProducersSleep)
+{
+  auto slow = std::make_shared<SlowSender>(std::chrono::milliseconds(100));
+  SharedSender theSender(slow);
+  theSender.connect_for_sends({ { "queue_capacity", 2 }, { "batch_size", 1 } });
+
+  // Producers waiting for room in the full queue sleep rather than spin, so the
+  // process uses a small fraction of the CPU time it would if each took a core
+  const int producers = 4;
+  auto cpu_start = std::clock();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&] {
+      int value = 0;
+      for (int i = 0; i < 2; ++i) {
+        theSender.send(&value, sizeof(value), Sender::block);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto cpu_seconds = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  BOOST_TEST_MESSAGE("Producers used " << cpu_seconds << " s of CPU time");
+  BOOST_REQUIRE(cpu_seconds < 0.2);
+
+  // With a short timeout a producer gives up on the full queue: the first message is
+  // being sent, and the other two wait in the queue
+  int value = 0;
+  for (int i = 0; i < 3; ++i) {
+    theSender.send(&value, sizeof(value), Sender::block);
+  }
+  BOOST_REQUIRE(theSender.try_send(&value, sizeof(value), std::chrono::milliseconds(10)) == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
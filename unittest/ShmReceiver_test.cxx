@@ -0,0 +1,206 @@
+/**
+ * @file ShmReceiver_test.cxx ShmReceiver class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE ShmReceiver_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ShmReceiver_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  BOOST_REQUIRE(theReceiver != nullptr);
+  BOOST_REQUIRE(!theReceiver->can_receive());
+}
+
+BOOST_AUTO_TEST_CASE(SendReceive)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+  std::vector<char> big_data(1 << 20, 'B');
+  theSender->send(big_data.data(), big_data.size(), Sender::block);
+  auto buffer = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(buffer.data.size(), big_data.size());
+  BOOST_REQUIRE(std::equal(buffer.data.begin(), buffer.data.end(), big_data.begin()));
+  BOOST_REQUIRE(buffer.metadata.empty());
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver->receive_buffer(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+  BOOST_REQUIRE(theReceiver->try_receive(Receiver::noblock).status == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(InPlaceBuffers)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test_in_place" },
+                                     { "segment_size", 4096 } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  // Held buffers keep their space, so the sender stalls until they are released,
+  // whichever order that happens in
+  std::vector<char> test_data(1000, 'T');
+  std::vector<Receiver::BufferResponse> held;
+  while (theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok) {
+    held.push_back(theReceiver->receive_buffer(Receiver::block));
+  }
+  BOOST_REQUIRE(held.size() > 1);
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Timeout);
+
+  held.back().data.reset();
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Timeout);
+  held.clear();
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok);
+}
+
+BOOST_AUTO_TEST_CASE(Wraparound)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test_wraparound" },
+                                     { "segment_size", 4096 } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  // Sizes which don't divide the ring, so records have to skip its end
+  std::thread sender([&] {
+    for (int i = 0; i < 10000; ++i) {
+      std::vector<int> test_data(1 + i % 300, i);
+      theSender->send(test_data.data(), test_data.size() * sizeof(int), Sender::block, std::to_string(i));
+    }
+  });
+
+  for (int i = 0; i < 10000; ++i) {
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+    BOOST_REQUIRE_EQUAL(response.data.size(), (1 + i % 300) * sizeof(int));
+    BOOST_REQUIRE_EQUAL(response.data.data_as<int>()[i % 300], i);
+    BOOST_REQUIRE_EQUAL(std::string(response.metadata.begin(), response.metadata.end()), std::to_string(i));
+  }
+  sender.join();
+}
+
+BOOST_AUTO_TEST_CASE(BetweenProcesses)
+{
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test_processes" },
+                                     { "segment_size", 65536 } };
+  theReceiver->connect_for_receives(connection_info);
+
+  auto child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if (child == 0) {
+    auto theSender = makeIPMSender("ShmSender");
+    theSender->connect_for_sends(connection_info);
+    for (int i = 0; i < 1000; ++i) {
+      theSender->send(&i, sizeof(i), Sender::block);
+    }
+    theSender.reset();
+    _exit(0);
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(5000));
+    BOOST_REQUIRE_EQUAL(*response.data.data_as<int>(), i);
+  }
+  int child_status = 0;
+  waitpid(child, &child_status, 0);
+  BOOST_REQUIRE(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(LeftOverSegment)
+{
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test_left_over" },
+                                     { "segment_size", 4096 } };
+
+  // A sender which exits without cleaning up leaves the segment behind, messages and all
+  auto child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if (child == 0) {
+    auto theSender = makeIPMSender("ShmSender");
+    theSender->connect_for_sends(connection_info);
+    for (int i = 0; i < 3; ++i) {
+      theSender->send(&i, sizeof(i), Sender::block);
+    }
+    _exit(0);
+  }
+  int child_status = 0;
+  waitpid(child, &child_status, 0);
+  BOOST_REQUIRE(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+
+  // The ring is started afresh, as its sender is no longer running
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  theReceiver->connect_for_receives(connection_info);
+  BOOST_REQUIRE(theReceiver->try_receive(Receiver::noblock).status == Status::Timeout);
+
+  auto theSender = makeIPMSender("ShmSender");
+  theSender->connect_for_sends(connection_info);
+  int value = 42;
+  theSender->send(&value, sizeof(value), Sender::block);
+  auto response = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(*response.data.data_as<int>(), 42);
+  BOOST_REQUIRE(theReceiver->try_receive(Receiver::noblock).status == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(SenderRestarts)
+{
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmReceiver_test_restart" },
+                                     { "segment_size", 4096 } };
+  theReceiver->connect_for_receives(connection_info);
+
+  // A new sender, here in another process, finds the segment the receiver is still
+  // reading from, rather than one of its own which nothing reads
+  for (int run = 0; run < 2; ++run) {
+    auto child = fork();
+    BOOST_REQUIRE(child >= 0);
+    if (child == 0) {
+      auto theSender = makeIPMSender("ShmSender");
+      theSender->connect_for_sends(connection_info);
+      theSender->send(&run, sizeof(run), Sender::block);
+      theSender.reset();
+      _exit(0);
+    }
+    auto response = theReceiver->receive_buffer(std::chrono::milliseconds(5000));
+    BOOST_REQUIRE_EQUAL(*response.data.data_as<int>(), run);
+    int child_status = 0;
+    waitpid(child, &child_status, 0);
+    BOOST_REQUIRE(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+  }
+
+  // Once both sides have gone, the segment goes too
+  theReceiver.reset();
+  BOOST_REQUIRE(access("/dev/shm/ipm_ShmReceiver_test_restart", F_OK) != 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+/**
+ * @file ShmSender_test.cxx ShmSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE ShmSender_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ShmSender_test)
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  BOOST_REQUIRE(theSender != nullptr);
+  BOOST_REQUIRE(!theSender->can_send());
+
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmSender_test_basic" },
+                                     { "segment_size", 4096 } };
+  theSender->connect_for_sends(connection_info);
+  BOOST_REQUIRE(theSender->can_send());
+
+  // The ring's record sizes are 32 bits
+  auto tooBigSender = makeIPMSender("ShmSender");
+  connection_info = { { "connection_string", "shm://ShmSender_test_too_big" },
+                      { "segment_size", (size_t{ 1 } << 32) + 1 } };
+  BOOST_REQUIRE_THROW(tooBigSender->connect_for_sends(connection_info), ers::Issue);
+  BOOST_REQUIRE(!tooBigSender->can_send());
+}
+
+BOOST_AUTO_TEST_CASE(SendTimeout)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmSender_test_timeout" },
+                                     { "segment_size", 4096 } };
+  theSender->connect_for_sends(connection_info);
+
+  // With nothing receiving, the ring fills up
+  std::vector<char> test_data(1000, 'T');
+  int sent = 0;
+  while (theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Ok) {
+    ++sent;
+  }
+  BOOST_REQUIRE(sent > 0);
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)) ==
+                Status::Timeout);
+  BOOST_REQUIRE_EXCEPTION(theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+
+  // A message which could never fit is refused outright
+  std::vector<char> too_big(4096, 'B');
+  BOOST_REQUIRE_THROW(theSender->send(too_big.data(), too_big.size(), Sender::noblock), ers::Issue);
+}
+
+BOOST_AUTO_TEST_CASE(SendMultipart)
+{
+  auto theSender = makeIPMSender("ShmSender");
+  auto theReceiver = makeIPMReceiver("ShmReceiver");
+  nlohmann::json connection_info = { { "connection_string", "shm://ShmSender_test_multipart" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload(1000, 'P');
+  const void* parts[] = { header.data(), payload.data() };
+  theSender->send_multipart(parts, { 3, 1000 }, Sender::block, "topic");
+
+  // The parts arrive as one message
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(response.data.size(), 1003);
+  BOOST_REQUIRE(std::string(response.data.begin(), response.data.begin() + 3) == "HDR");
+  BOOST_REQUIRE_EQUAL(response.data[3], 'P');
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
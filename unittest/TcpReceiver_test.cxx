@@ -0,0 +1,177 @@
+/**
+ * @file TcpReceiver_test.cxx TcpReceiver and UringReceiver class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE TcpReceiver_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(TcpReceiver_test)
+
+namespace {
+
+// The Uring plugins speak the same protocol as the Tcp ones, so each test runs with both
+const std::vector<std::string> backends{ "Tcp", "Uring" };
+
+// The Uring backend's port is 20 above the Tcp one's, so that the two don't meet
+std::string
+address(int port, std::string const& backend)
+{
+  return "tcp://127.0.0.1:" + std::to_string(backend == "Uring" ? port + 20 : port);
+}
+
+// Without io_uring the Uring plugins fall back to the socket calls, which is only worth a
+// warning; with it, their I/O has to have gone through the ring
+void
+check_ring_used(std::string const& backend, nlohmann::json const& statistics)
+{
+  if (backend != "Uring") {
+    return;
+  }
+  BOOST_WARN_MESSAGE(statistics.value("io_uring", false), "io_uring isn't available, so it wasn't tested");
+  if (statistics.value("io_uring", false)) {
+    BOOST_REQUIRE(statistics.value<uint64_t>("io_uring_operations", 0) > 0);
+  }
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      BOOST_REQUIRE(theReceiver != nullptr);
+      BOOST_REQUIRE(!theReceiver->can_receive());
+
+      nlohmann::json connection_info = { { "connection_string", address(29460, backend) } };
+      theReceiver->connect_for_receives(connection_info);
+      BOOST_REQUIRE(theReceiver->can_receive());
+      BOOST_REQUIRE_THROW(makeIPMReceiver(backend + "Receiver")->connect_for_receives(connection_info), ers::Issue);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendReceive)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      nlohmann::json connection_info = { { "connection_string", address(29461, backend) } };
+      // The sender connects once the receiver is there
+      std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+      theSender->connect_for_sends(connection_info);
+      BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(20)) ==
+                    Status::Timeout);
+      theReceiver->connect_for_receives(connection_info);
+      BOOST_REQUIRE(theReceiver->try_receive(std::chrono::milliseconds(20)).status == Status::Timeout);
+
+      theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(1000), "topic");
+      auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+      BOOST_REQUIRE(response.data == test_data);
+      BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+      // Larger than both the socket and receive buffers
+      std::vector<char> big_data(16 << 20);
+      for (size_t i = 0; i < big_data.size(); ++i) {
+        big_data[i] = static_cast<char>(i % 251);
+      }
+      std::thread sender([&] { theSender->send(big_data.data(), big_data.size(), Sender::block); });
+      auto buffer = theReceiver->receive_buffer(std::chrono::milliseconds(5000));
+      sender.join();
+      BOOST_REQUIRE_EQUAL(buffer.data.size(), big_data.size());
+      BOOST_REQUIRE(std::equal(buffer.data.begin(), buffer.data.end(), big_data.begin()));
+      BOOST_REQUIRE(buffer.metadata.empty());
+
+      BOOST_REQUIRE_EXCEPTION(theReceiver->receive_buffer(std::chrono::milliseconds(10)),
+                              dunedaq::ipm::ReceiveTimeoutExpired,
+                              [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+      check_ring_used(backend, theReceiver->statistics());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ManyMessages)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      nlohmann::json connection_info = { { "connection_string", address(29462, backend) },
+                                         { "receive_buffer_size", 4096 } };
+      theReceiver->connect_for_receives(connection_info);
+      theSender->connect_for_sends(connection_info);
+
+      // Sizes either side of the receive buffer, so frames are split across reads
+      std::thread sender([&] {
+        for (int i = 0; i < 5000; ++i) {
+          std::vector<int> test_data(1 + (i * 37) % 3000, i);
+          theSender->send(test_data.data(), test_data.size() * sizeof(int), Sender::block, std::to_string(i));
+        }
+      });
+
+      for (int i = 0; i < 5000; ++i) {
+        // Short timeouts may give up partway through a frame, which the next call finishes
+        Result<Receiver::BufferResponse> response;
+        do {
+          response = theReceiver->try_receive_buffer(std::chrono::milliseconds(1));
+        } while (response.status == Status::Timeout);
+        BOOST_REQUIRE(response.ok());
+        BOOST_REQUIRE_EQUAL(response->data.size(), (1 + (i * 37) % 3000) * sizeof(int));
+        BOOST_REQUIRE_EQUAL(response->data.data_as<int>()[(i * 37) % 3000], i);
+        BOOST_REQUIRE_EQUAL(std::string(response->metadata.begin(), response->metadata.end()), std::to_string(i));
+      }
+      sender.join();
+      check_ring_used(backend, theReceiver->statistics());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MaxMessageSize)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      nlohmann::json connection_info = { { "connection_string", address(29463, backend) },
+                                         { "max_message_size", 1000 } };
+      theReceiver->connect_for_receives(connection_info);
+      theSender->connect_for_sends(connection_info);
+
+      // The topic counts towards the size too
+      std::vector<char> test_data(996, 'T');
+      theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+      BOOST_REQUIRE(theReceiver->try_receive(std::chrono::milliseconds(1000)).status == Status::Error);
+
+      // The connection is dropped, and the receiver waits for another
+      auto otherSender = makeIPMSender(backend + "Sender");
+      otherSender->connect_for_sends(connection_info);
+      otherSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(1000), "top");
+      auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+      BOOST_REQUIRE(response.data == test_data);
+      BOOST_REQUIRE_EQUAL(response.metadata, "top");
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
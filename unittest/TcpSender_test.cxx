@@ -0,0 +1,287 @@
+/**
+ * @file TcpSender_test.cxx TcpSender and UringSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
+
+#define BOOST_TEST_MODULE TcpSender_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(TcpSender_test)
+
+namespace {
+
+// The Uring plugins speak the same protocol as the Tcp ones, so each test runs with both
+const std::vector<std::string> backends{ "Tcp", "Uring" };
+
+// The Uring backend's port is 20 above the Tcp one's, so that the two don't meet
+std::string
+address(std::string const& host, int port, std::string const& backend)
+{
+  return "tcp://" + host + ":" + std::to_string(backend == "Uring" ? port + 20 : port);
+}
+
+// Without io_uring the Uring plugins fall back to the socket calls, which is only worth a
+// warning; with it, their I/O has to have gone through the ring
+void
+check_ring_used(std::string const& backend, nlohmann::json const& statistics)
+{
+  if (backend != "Uring") {
+    return;
+  }
+  BOOST_WARN_MESSAGE(statistics.value("io_uring", false), "io_uring isn't available, so it wasn't tested");
+  if (statistics.value("io_uring", false)) {
+    BOOST_REQUIRE(statistics.value<uint64_t>("io_uring_operations", 0) > 0);
+  }
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(BasicTests)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      BOOST_REQUIRE(theSender != nullptr);
+      BOOST_REQUIRE(!theSender->can_send());
+
+      nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", 29451, backend) } };
+      theSender->connect_for_sends(connection_info);
+      BOOST_REQUIRE(theSender->can_send());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(NoSockets)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+
+      // With the file descriptor limit at the lowest free descriptor, no socket can be made
+      int lowest_free = dup(0);
+      close(lowest_free);
+      rlimit original;
+      getrlimit(RLIMIT_NOFILE, &original);
+      rlimit lowered = original;
+      lowered.rlim_cur = lowest_free;
+      setrlimit(RLIMIT_NOFILE, &lowered);
+
+      nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", 29452, backend) } };
+      bool threw = false;
+      try {
+        theSender->connect_for_sends(connection_info);
+      } catch (ers::Issue const& issue) {
+        threw = true;
+        BOOST_TEST_MESSAGE(issue.what());
+      }
+      setrlimit(RLIMIT_NOFILE, &original);
+      BOOST_REQUIRE(threw);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendTimeout)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", 29452, backend) },
+                                         { "socket_buffer_size", 65536 } };
+      theSender->connect_for_sends(connection_info);
+
+      // Nothing is listening
+      std::vector<char> test_data(1000, 'T');
+      BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)) ==
+                    Status::Timeout);
+      BOOST_REQUIRE_EXCEPTION(theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)),
+                              dunedaq::ipm::SendTimeoutExpired,
+                              [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+
+      // A receiver which doesn't read lets the socket fill up
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      theReceiver->connect_for_receives(connection_info);
+      int sent = 0;
+      while (theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(100)) ==
+             Status::Ok) {
+        ++sent;
+      }
+      BOOST_REQUIRE(sent > 0);
+
+      // The end of a frame which was cut off by its deadline goes out with the next send,
+      // and everything arrives whole
+      std::thread sender([&] { theSender->send(test_data.data(), test_data.size(), Sender::block); });
+      for (int i = 0; i <= sent; ++i) {
+        auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+        BOOST_REQUIRE(response.data == test_data);
+      }
+      sender.join();
+      check_ring_used(backend, theSender->statistics());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendMultipart)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      theReceiver->connect_for_receives({ { "connection_string", address("*", 29453, backend) } });
+      theSender->connect_for_sends({ { "connection_string", address("127.0.0.1", 29453, backend) } });
+
+      std::vector<char> header{ 'H', 'D', 'R' };
+      std::vector<char> payload(1000, 'P');
+      const void* parts[] = { header.data(), payload.data() };
+      theSender->send_multipart(parts, { 3, 1000 }, Sender::block, "topic");
+
+      // The parts arrive as one message
+      auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+      BOOST_REQUIRE_EQUAL(response.data.size(), 1003);
+      BOOST_REQUIRE(std::string(response.data.begin(), response.data.begin() + 3) == "HDR");
+      BOOST_REQUIRE_EQUAL(response.data[3], 'P');
+      BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+      check_ring_used(backend, theSender->statistics());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ReceiverReconnects)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", 29454, backend) } };
+      theSender->connect_for_sends(connection_info);
+
+      std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+      {
+        auto theReceiver = makeIPMReceiver(backend + "Receiver");
+        theReceiver->connect_for_receives(connection_info);
+        theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(1000));
+        BOOST_REQUIRE(theReceiver->receive(std::chrono::milliseconds(1000)).data == test_data);
+      }
+
+      // Sends to the receiver which went away fail, and then wait for another one
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      for (int i = 0; i < 100; ++i) {
+        if (theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(10)) ==
+            Status::Error) {
+          break;
+        }
+      }
+      theReceiver->connect_for_receives(connection_info);
+      theSender->send(test_data.data(), test_data.size(), std::chrono::milliseconds(1000));
+      BOOST_REQUIRE(theReceiver->receive(std::chrono::milliseconds(1000)).data == test_data);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SendBatch)
+{
+  for (auto const& backend : backends) {
+    BOOST_TEST_CONTEXT(backend)
+    {
+      auto theSender = makeIPMSender(backend + "Sender");
+      auto theReceiver = makeIPMReceiver(backend + "Receiver");
+      nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", 29455, backend) } };
+      theReceiver->connect_for_receives(connection_info);
+      theSender->connect_for_sends(connection_info);
+
+      // The batch goes out as a run of frames, each arriving as its own message
+      std::vector<std::vector<char>> messages;
+      std::vector<std::string> topics;
+      for (int i = 0; i < 100; ++i) {
+        messages.emplace_back(1 + i * 10, static_cast<char>(i));
+        topics.push_back(std::to_string(i));
+      }
+      std::vector<Sender::BatchEntry> batch;
+      for (int i = 0; i < 100; ++i) {
+        batch.push_back({ messages[i].data(), static_cast<Sender::size_type>(messages[i].size()), topics[i] });
+      }
+      theSender->send_batch(batch, std::chrono::milliseconds(1000));
+      for (int i = 0; i < 100; ++i) {
+        auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+        BOOST_REQUIRE(response.data == messages[i]);
+        BOOST_REQUIRE_EQUAL(response.metadata, topics[i]);
+      }
+      check_ring_used(backend, theSender->statistics());
+    }
+  }
+}
+
+// Every Uring plugin in the process goes through the same ring, small frames are written
+// from the registered send buffer, and larger ones still arrive whole
+BOOST_AUTO_TEST_CASE(SharedRing)
+{
+  std::vector<std::shared_ptr<Sender>> senders;
+  std::vector<std::shared_ptr<Receiver>> receivers;
+  for (int port : { 29456, 29457 }) {
+    nlohmann::json connection_info = { { "connection_string", address("127.0.0.1", port, "Uring") },
+                                       { "send_buffer_size", 1024 } };
+    receivers.push_back(makeIPMReceiver("UringReceiver"));
+    receivers.back()->connect_for_receives(connection_info);
+    senders.push_back(makeIPMSender("UringSender"));
+    senders.back()->connect_for_sends(connection_info);
+  }
+
+  std::vector<char> small(100, 'S');
+  std::vector<char> large(4000, 'L');
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < senders.size(); ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 50; ++j) {
+        auto const& data = j % 2 == 0 ? small : large;
+        senders[i]->send(data.data(), data.size(), std::chrono::milliseconds(1000));
+        BOOST_REQUIRE(receivers[i]->receive(std::chrono::milliseconds(1000)).data == data);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto statistics = senders.front()->statistics();
+  BOOST_WARN_MESSAGE(statistics.value("io_uring", false), "io_uring isn't available, so it wasn't tested");
+  if (!statistics.value("io_uring", false)) {
+    return;
+  }
+  BOOST_WARN_MESSAGE(statistics.value("io_uring_fixed_buffer", false),
+                     "The send buffer couldn't be registered, so IORING_OP_WRITE_FIXED wasn't tested");
+  uint64_t operations = 0;
+  auto ring_operations = statistics.value<uint64_t>("io_uring_ring_operations", 0);
+  for (auto const& plugin : { senders[0]->statistics(),
+                              senders[1]->statistics(),
+                              receivers[0]->statistics(),
+                              receivers[1]->statistics() }) {
+    BOOST_REQUIRE(plugin.value<uint64_t>("io_uring_operations", 0) > 0);
+    BOOST_REQUIRE_EQUAL(plugin.value<uint64_t>("io_uring_ring_operations", 0), ring_operations);
+    operations += plugin.value<uint64_t>("io_uring_operations", 0);
+  }
+  BOOST_REQUIRE(ring_operations >= operations);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
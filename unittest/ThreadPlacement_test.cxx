@@ -0,0 +1,83 @@
+/**
+ * @file ThreadPlacement_test.cxx ThreadPlacement Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/ThreadPlacement.hpp"
+
+#define BOOST_TEST_MODULE ThreadPlacement_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ThreadPlacement_test)
+
+namespace {
+
+// The CPUs this process may run on, which a container may have restricted
+std::vector<int>
+allowed_cpus()
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  sched_getaffinity(0, sizeof(set), &set);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_CASE(CpusFor)
+{
+  nlohmann::json config = { { "io_thread_cpus", { 2, 3 } } };
+  BOOST_REQUIRE(placement::cpus_for(config, "io_thread_cpus") == std::vector<int>({ 2, 3 }));
+  BOOST_REQUIRE(placement::cpus_for(config, "worker_thread_cpus").empty());
+}
+
+BOOST_AUTO_TEST_CASE(PinThisThread)
+{
+  auto cpus = allowed_cpus();
+  BOOST_REQUIRE(!cpus.empty());
+
+  // Done on a thread of its own so that the test's thread isn't left pinned
+  int ran_on = -1;
+  bool pinned = false;
+  std::thread pinned_thread([&] {
+    pinned = placement::pin_this_thread({ cpus.back() });
+    ran_on = sched_getcpu();
+  });
+  pinned_thread.join();
+  BOOST_REQUIRE(pinned);
+  BOOST_REQUIRE_EQUAL(ran_on, cpus.back());
+
+  // No CPUs leaves the thread alone
+  BOOST_REQUIRE(placement::pin_this_thread({}));
+  BOOST_REQUIRE(allowed_cpus() == cpus);
+}
+
+BOOST_AUTO_TEST_CASE(MoveToLocalNode)
+{
+  BOOST_REQUIRE(placement::current_node() >= 0);
+
+  // Whether the pages can be moved depends on the kernel, but the memory has to stay usable
+  std::vector<char> buffer(1 << 20, 'A');
+  placement::move_to_local_node(buffer.data(), buffer.size());
+  BOOST_REQUIRE(std::all_of(buffer.begin(), buffer.end(), [](char c) { return c == 'A'; }));
+
+  // Less than a page has nothing to move
+  BOOST_REQUIRE(placement::move_to_local_node(buffer.data() + 1, 16));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+/**
+ * @file ZmqContext_test.cxx ZmqContext class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "ipm/ZmqContext.hpp"
+
+#define BOOST_TEST_MODULE ZmqContext_test // NOLINT
+
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <utility>
+
+using namespace dunedaq::ipm;
+
+BOOST_AUTO_TEST_SUITE(ZmqContext_test)
+
+// The context is created once per process, so the cases have to run in this order
+BOOST_AUTO_TEST_CASE(BadEnvironment)
+{
+  for (auto [variable, value] : { std::pair{ "IPM_ZMQ_IO_THREADS", "two" },
+                                  std::pair{ "IPM_ZMQ_MAX_SOCKETS", "99999999999" },
+                                  std::pair{ "IPM_ZMQ_THREAD_PRIORITY", "4x" },
+                                  std::pair{ "IPM_ZMQ_THREAD_AFFINITY", "2,,3" } }) {
+    BOOST_TEST_CONTEXT(variable)
+    {
+      setenv(variable, value, 1);
+      BOOST_REQUIRE_EXCEPTION(ZmqContext::instance(),
+                              dunedaq::ipm::ZmqContextBadEnvironment,
+                              [&](dunedaq::ipm::ZmqContextBadEnvironment) { return true; });
+      unsetenv(variable);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ConfigureBeforeUse)
+{
+  // As a DAQModule's init() does
+  ZmqContext::configure_from_init({ { "zmq_context", { { "io_threads", 2 }, { "max_sockets", 512 } } } });
+  // The environment overrides the JSON
+  setenv("IPM_ZMQ_MAX_SOCKETS", "256", 1);
+
+  auto context = static_cast<void*>(ZmqContext::instance().GetContext());
+  BOOST_REQUIRE_EQUAL(zmq_ctx_get(context, ZMQ_IO_THREADS), 2);
+  BOOST_REQUIRE_EQUAL(zmq_ctx_get(context, ZMQ_MAX_SOCKETS), 256);
+}
+
+BOOST_AUTO_TEST_CASE(ConfigureAfterUse)
+{
+  BOOST_REQUIRE_EXCEPTION(ZmqContext::configure({ { "io_threads", 4 } }),
+                          dunedaq::ipm::ZmqContextAlreadyCreated,
+                          [&](dunedaq::ipm::ZmqContextAlreadyCreated) { return true; });
+
+  // Modules initialised later leave the context alone
+  ZmqContext::configure_from_init({ { "qinfos", nlohmann::json::array() } });
+}
+
+BOOST_AUTO_TEST_CASE(SocketAffinity)
+{
+  zmq::socket_t socket(ZmqContext::instance().GetContext(), zmq::socket_type::pull);
+  ZmqContext::set_io_thread_affinity(socket, { { "io_thread_affinity", 2 } });
+  BOOST_REQUIRE_EQUAL(socket.getsockopt<uint64_t>(ZMQ_AFFINITY), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,12 +6,19 @@
  * received with this code.
  */
 
+#include "ipm/MessagePump.hpp"
 #include "ipm/Receiver.hpp"
+#include "ipm/Sender.hpp"
 
 #define BOOST_TEST_MODULE ZmqReceiver_test // NOLINT
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace dunedaq::ipm;
@@ -25,4 +32,227 @@ BOOST_AUTO_TEST_CASE(BasicTests)
   BOOST_REQUIRE(!theReceiver->can_receive());
 }
 
+BOOST_AUTO_TEST_CASE(SendReceive)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+  std::vector<char> big_data(1 << 20, 'B');
+  theSender->send(big_data.data(), big_data.size(), Sender::block);
+  auto buffer = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(buffer.data.size(), big_data.size());
+  BOOST_REQUIRE(std::equal(buffer.data.begin(), buffer.data.end(), big_data.begin()));
+  BOOST_REQUIRE(buffer.metadata.empty());
+
+  BOOST_REQUIRE_EXCEPTION(theReceiver->receive_buffer(std::chrono::milliseconds(10)),
+                          dunedaq::ipm::ReceiveTimeoutExpired,
+                          [&](dunedaq::ipm::ReceiveTimeoutExpired) { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(TryReceive)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_try" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  auto timed_out = theReceiver->try_receive(std::chrono::milliseconds(10));
+  BOOST_REQUIRE(timed_out.status == Status::Timeout);
+  BOOST_REQUIRE(!timed_out);
+
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::block, "topic") == Status::Ok);
+  auto response = theReceiver->try_receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.ok());
+  BOOST_REQUIRE(response->data == test_data);
+  BOOST_REQUIRE_EQUAL(response->metadata, "topic");
+
+  theSender->send(test_data.data(), test_data.size(), Sender::block);
+  auto buffer = theReceiver->try_receive_buffer(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(buffer.ok());
+  BOOST_REQUIRE(std::equal(buffer->data.begin(), buffer->data.end(), test_data.begin()));
+
+  BOOST_REQUIRE(theReceiver->try_receive_buffer(Receiver::noblock).status == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(OnMessage)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_on_message" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<int> received;
+  MessagePump thePump(theReceiver);
+  thePump.on_message(
+    [&](Receiver::BufferResponse& message) {
+      std::lock_guard<std::mutex> lock(mutex);
+      received.push_back(*message.data.data_as<int>());
+      cv.notify_one();
+    },
+    16);
+  thePump.start();
+
+  for (int i = 0; i < 50; ++i) {
+    theSender->send(&i, sizeof(i), Sender::block);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_REQUIRE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return received.size() == 50; }));
+  }
+  thePump.stop();
+
+  for (int i = 0; i < 50; ++i) {
+    BOOST_REQUIRE_EQUAL(received[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveInto)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_into" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<int> ints{ 1, 2, 3, 4 };
+  std::vector<int> received(4);
+  std::string topic;
+  theSender->send(ints.data(), ints.size() * sizeof(int), Sender::block, "topic");
+  auto response = theReceiver->receive_into(received.data(), received.size() * sizeof(int), Receiver::block, &topic);
+  BOOST_REQUIRE_EQUAL(response.size, 4 * sizeof(int));
+  BOOST_REQUIRE(!response.truncated);
+  BOOST_REQUIRE(received == ints);
+  BOOST_REQUIRE_EQUAL(topic, "topic");
+
+  // Multipart messages are received back to back, and truncated if they don't fit
+  const void* parts[] = { ints.data(), ints.data() };
+  theSender->send_multipart(parts, { 2 * sizeof(int), 4 * sizeof(int) }, Sender::block);
+  std::fill(received.begin(), received.end(), 0);
+  response = theReceiver->receive_into(received.data(), received.size() * sizeof(int), Receiver::block);
+  BOOST_REQUIRE_EQUAL(response.size, 6 * sizeof(int));
+  BOOST_REQUIRE(response.truncated);
+  BOOST_REQUIRE(received == std::vector<int>({ 1, 2, 1, 2 }));
+
+  response = theReceiver->receive_into(received.data(), received.size() * sizeof(int), std::chrono::milliseconds(10));
+  BOOST_REQUIRE_EQUAL(response.size, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveBatch)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_batch" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<Receiver::BufferResponse> messages;
+  BOOST_REQUIRE_EQUAL(theReceiver->receive_batch(messages, 10, std::chrono::milliseconds(10)), 0);
+
+  for (int i = 0; i < 5; ++i) {
+    theSender->send(&i, sizeof(i), Sender::block);
+  }
+  BOOST_REQUIRE_EQUAL(theReceiver->receive_batch(messages, 3, std::chrono::milliseconds(1000)), 3);
+  BOOST_REQUIRE_EQUAL(*messages[0].data.data_as<int>(), 0);
+  BOOST_REQUIRE_EQUAL(*messages[2].data.data_as<int>(), 2);
+
+  BOOST_REQUIRE_EQUAL(theReceiver->receive_batch(messages, 10, std::chrono::milliseconds(1000)), 2);
+  BOOST_REQUIRE_EQUAL(*messages[1].data.data_as<int>(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(FanIn)
+{
+  // One receiver takes messages from senders on different endpoints
+  auto localSender = makeIPMSender("ZmqSender");
+  auto remoteSender = makeIPMSender("ZmqSender");
+  localSender->connect_for_sends({ { "connection_string", "inproc://ZmqReceiver_test_fan_in_local" } });
+  remoteSender->connect_for_sends({ { "connection_string", "tcp://127.0.0.1:29520" } });
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = {
+    { "connection_string", { "inproc://ZmqReceiver_test_fan_in_local", "tcp://127.0.0.1:29520" } }
+  };
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<char> local_data{ 'L', 'O', 'C', 'A', 'L' };
+  std::vector<char> remote_data{ 'R', 'E', 'M', 'O', 'T', 'E' };
+  localSender->send(local_data.data(), local_data.size(), std::chrono::milliseconds(1000));
+  remoteSender->send(remote_data.data(), remote_data.size(), std::chrono::milliseconds(1000));
+  std::vector<std::vector<char>> received;
+  for (int i = 0; i < 2; ++i) {
+    received.push_back(theReceiver->receive(std::chrono::milliseconds(1000)).data);
+  }
+  BOOST_REQUIRE(std::find(received.begin(), received.end(), local_data) != received.end());
+  BOOST_REQUIRE(std::find(received.begin(), received.end(), remote_data) != received.end());
+}
+
+BOOST_AUTO_TEST_CASE(BusyPoll)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  BOOST_REQUIRE(theReceiver->statistics()["spin_hits"] == 0);
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_busy_poll" },
+                                     { "busy_poll_us", 2000 },
+                                     { "busy_poll_adaptive", false } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  // A message which is already waiting is found by the spin
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block, "topic");
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+  BOOST_REQUIRE(theReceiver->statistics()["spin_hits"] == 1);
+
+  // With nothing to find, the spin gives up and the rest of the timeout is waited out
+  auto start = std::chrono::steady_clock::now();
+  auto timed_out = theReceiver->try_receive_buffer(std::chrono::milliseconds(20));
+  BOOST_REQUIRE(timed_out.status == Status::Timeout);
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+  BOOST_REQUIRE(theReceiver->statistics()["spin_misses"] == 1);
+  BOOST_REQUIRE(theReceiver->statistics()["spin_budget_us"] == 2000);
+
+  // A message which arrives after the spin still wakes the blocking receive
+  std::thread late_sender([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    theSender->send(test_data.data(), test_data.size(), Sender::block);
+  });
+  auto late = theReceiver->receive_buffer(std::chrono::milliseconds(1000));
+  late_sender.join();
+  BOOST_REQUIRE_EQUAL(late.data.size(), test_data.size());
+  BOOST_REQUIRE(theReceiver->statistics()["spin_misses"] == 2);
+}
+
+BOOST_AUTO_TEST_CASE(AdaptiveBusyPoll)
+{
+  // Messages further apart than busy_poll_us turn the spin off
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqReceiver_test_adaptive_busy_poll" },
+                                     { "busy_poll_us", 100 } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  int value = 0;
+  for (int i = 0; i < 3; ++i) {
+    theSender->send(&value, sizeof(value), Sender::block);
+    theReceiver->receive(std::chrono::milliseconds(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  BOOST_REQUIRE(theReceiver->statistics()["spin_budget_us"] == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
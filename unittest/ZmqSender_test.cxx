@@ -6,13 +6,20 @@
  * received with this code.
  */
 
+#include "ipm/Receiver.hpp"
 #include "ipm/Sender.hpp"
+#include "ipm/Subscriber.hpp"
 
 #define BOOST_TEST_MODULE ZmqSender_test // NOLINT
 
 #include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
+#include <zmq.hpp>
 
 using namespace dunedaq::ipm;
 
@@ -25,5 +32,217 @@ BOOST_AUTO_TEST_CASE(BasicTests)
   BOOST_REQUIRE(!theSender->can_send());
 }
 
+BOOST_AUTO_TEST_CASE(SendBuffer)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqSender_test" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  auto owner = std::make_unique<std::vector<char>>(1 << 20, 'B');
+  const char* payload = owner->data();
+  auto payload_size = static_cast<Sender::size_type>(owner->size());
+  std::weak_ptr<std::vector<char>> watcher;
+  {
+    std::shared_ptr<std::vector<char>> shared_owner(std::move(owner));
+    watcher = shared_owner;
+    theSender->send(MessageBuffer::adopt(std::move(shared_owner), payload, payload_size), Sender::block, "topic");
+  }
+
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(response.data.size(), 1 << 20);
+  BOOST_REQUIRE_EQUAL(response.data[0], 'B');
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+
+  // ZMQ releases the buffer asynchronously once it is done with it
+  for (int i = 0; i < 100 && !watcher.expired(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  BOOST_REQUIRE(watcher.expired());
+}
+
+BOOST_AUTO_TEST_CASE(SendMultipart)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqSender_test_multipart" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<char> header{ 'H', 'D', 'R' };
+  std::vector<char> payload(1000, 'P');
+  const void* parts[] = { header.data(), payload.data() };
+  theSender->send_multipart(parts, { 3, 1000 }, Sender::block, "topic");
+
+  auto multipart = theReceiver->receive_multipart(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(std::string(multipart.metadata.begin(), multipart.metadata.end()), "topic");
+  BOOST_REQUIRE_EQUAL(multipart.data.size(), 2);
+  BOOST_REQUIRE_EQUAL(multipart.data[0].size(), 3);
+  BOOST_REQUIRE_EQUAL(multipart.data[1].size(), 1000);
+
+  std::vector<MessageBuffer> buffers;
+  buffers.push_back(MessageBuffer::adopt(std::vector<char>(header)));
+  buffers.push_back(MessageBuffer::adopt(std::vector<char>(payload)));
+  theSender->send_multipart(std::move(buffers), Sender::block);
+
+  // Receivers which don't ask for the parts get them joined together
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE_EQUAL(response.data.size(), 1003);
+  BOOST_REQUIRE_EQUAL(response.data[0], 'H');
+  BOOST_REQUIRE_EQUAL(response.data[3], 'P');
+}
+
+BOOST_AUTO_TEST_CASE(SendBatch)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqSender_test_batch" } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  std::vector<int> values{ 0, 1, 2, 3 };
+  std::vector<Sender::BatchEntry> batch;
+  for (auto& value : values) {
+    batch.push_back({ &value, sizeof(value), "topic" });
+  }
+  theSender->send_batch(batch, std::chrono::milliseconds(1000));
+
+  std::vector<Receiver::BufferResponse> messages;
+  BOOST_REQUIRE_EQUAL(theReceiver->receive_batch(messages, 10, std::chrono::milliseconds(1000)), 4);
+  BOOST_REQUIRE_EQUAL(*messages[3].data.data_as<int>(), 3);
+  BOOST_REQUIRE_EQUAL(std::string(messages[3].metadata.begin(), messages[3].metadata.end()), "topic");
+}
+
+BOOST_AUTO_TEST_CASE(SendTimeout)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  theSender->connect_for_sends({ { "connection_string", "inproc://ZmqSender_test_timeout" } });
+
+  // With nobody connected, a PUSH socket can't send, so the whole timeout should elapse
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  auto timeout = std::chrono::milliseconds(50);
+  auto start = std::chrono::steady_clock::now();
+  BOOST_REQUIRE_EXCEPTION(theSender->send(test_data.data(), test_data.size(), timeout, "topic"),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start >= timeout);
+
+  BOOST_REQUIRE_EXCEPTION(theSender->send(test_data.data(), test_data.size(), Sender::noblock),
+                          dunedaq::ipm::SendTimeoutExpired,
+                          [&](dunedaq::ipm::SendTimeoutExpired) { return true; });
+
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), timeout) == Status::Timeout);
+  BOOST_REQUIRE(theSender->try_send(test_data.data(), test_data.size(), Sender::noblock) == Status::Timeout);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncSend)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqSender_test_async" },
+                                     { "async_send", true },
+                                     { "async_queue_capacity", 4 } };
+  theSender->connect_for_sends(connection_info);
+
+  // With nobody connected, sends are queued rather than waiting for the socket
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  auto timeout = std::chrono::milliseconds(100);
+  auto start = std::chrono::steady_clock::now();
+  theSender->send(test_data.data(), test_data.size(), timeout);
+  BOOST_REQUIRE(std::chrono::steady_clock::now() - start < timeout);
+
+  auto timed_out = theSender->send_async(MessageBuffer::adopt(std::vector<char>(test_data)), timeout);
+  BOOST_REQUIRE(timed_out.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  BOOST_REQUIRE(timed_out.get() == Status::Timeout);
+
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  theReceiver->connect_for_receives(connection_info);
+  auto delivered = theSender->send_async(MessageBuffer::adopt(std::vector<char>(test_data)), Sender::block, "topic");
+  BOOST_REQUIRE(delivered.get() == Status::Ok);
+
+  auto response = theReceiver->receive(std::chrono::milliseconds(1000));
+  BOOST_REQUIRE(response.data == test_data);
+  BOOST_REQUIRE_EQUAL(response.metadata, "topic");
+}
+
+BOOST_AUTO_TEST_CASE(AsyncSendReconnect)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json first_info = { { "connection_string", "inproc://ZmqSender_test_async_reconnect_1" },
+                                { "async_send", true } };
+  nlohmann::json second_info = { { "connection_string", "inproc://ZmqSender_test_async_reconnect_2" },
+                                 { "async_send", true } };
+  theSender->connect_for_sends(first_info);
+  theReceiver->connect_for_receives(first_info);
+
+  // The background thread is restarted rather than replaced while still running
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  theSender->send(test_data.data(), test_data.size(), Sender::block);
+  theSender->connect_for_sends(second_info);
+  theSender->send(test_data.data(), test_data.size(), Sender::block);
+  for (int i = 0; i < 2; ++i) {
+    BOOST_REQUIRE(theReceiver->receive(std::chrono::milliseconds(1000)).data == test_data);
+  }
+
+  // Without async_send, the socket is used directly again
+  theSender->connect_for_sends({ { "connection_string", "inproc://ZmqSender_test_async_reconnect_3" } });
+  BOOST_REQUIRE(theSender->poll_handle().valid());
+}
+
+BOOST_AUTO_TEST_CASE(SocketOptions)
+{
+  auto theSender = makeIPMSender("ZmqSender");
+  auto theReceiver = makeIPMReceiver("ZmqReceiver");
+  nlohmann::json connection_info = { { "connection_string", "inproc://ZmqSender_test_options" },
+                                     { "sndhwm", 2 },
+                                     { "rcvhwm", 2 },
+                                     { "immediate", true },
+                                     { "linger", 0 } };
+  theSender->connect_for_sends(connection_info);
+  theReceiver->connect_for_receives(connection_info);
+
+  // The high water marks limit how much can be queued while nothing is received,
+  // rather than ZMQ's default of 1000 messages each side
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  int sent = 0;
+  while (theSender->try_send(test_data.data(), test_data.size(), std::chrono::milliseconds(20)) == Status::Ok) {
+    ++sent;
+  }
+  BOOST_REQUIRE(sent > 0);
+  BOOST_REQUIRE(sent < 100);
+
+  // Values ZMQ rejects aren't ignored
+  auto badSender = makeIPMSender("ZmqSender");
+  BOOST_REQUIRE_THROW(
+    badSender->connect_for_sends({ { "connection_string", "inproc://ZmqSender_test_bad" }, { "sndhwm", -5 } }),
+    zmq::error_t);
+}
+
+BOOST_AUTO_TEST_CASE(MultipleEndpoints)
+{
+  // Local consumers can take ipc:// while remote ones take tcp:// from the same socket
+  auto thePublisher = makeIPMSender("ZmqPublisher");
+  thePublisher->connect_for_sends(
+    { { "connection_string", { "ipc:///tmp/ZmqSender_test_endpoints", "tcp://127.0.0.1:29521" } } });
+  auto localSubscriber = makeIPMSubscriber("ZmqSubscriber");
+  auto remoteSubscriber = makeIPMSubscriber("ZmqSubscriber");
+  localSubscriber->connect_for_receives({ { "connection_string", "ipc:///tmp/ZmqSender_test_endpoints" } });
+  remoteSubscriber->connect_for_receives({ { "connection_string", "tcp://127.0.0.1:29521" } });
+  localSubscriber->subscribe("topic");
+  remoteSubscriber->subscribe("topic");
+
+  // Subscriptions take a moment to reach the publisher, so keep publishing until both have one
+  std::vector<char> test_data{ 'T', 'E', 'S', 'T' };
+  for (auto& subscriber : { localSubscriber, remoteSubscriber }) {
+    Result<Receiver::Response> response;
+    for (int i = 0; i < 100 && !response.ok(); ++i) {
+      thePublisher->send(test_data.data(), test_data.size(), Sender::block, "topic");
+      response = subscriber->try_receive(std::chrono::milliseconds(10));
+    }
+    BOOST_REQUIRE(response.ok());
+    BOOST_REQUIRE(response->data == test_data);
+  }
+}
 
 BOOST_AUTO_TEST_SUITE_END()